@@ -0,0 +1,43 @@
+;; Time switching among many buffers that have many local variables.
+;; Run it with
+;;	emacs -batch -l ../etc/bench-buffers.el
+;; from the src directory, with the new emacs and then with an old one.
+;; Each of 1000 buffers gets 50 Lisp locals and 3 locals of variables
+;; that live in C, and then set-buffer goes round them all 100 times.
+;; The time printed should not grow with the number of Lisp locals;
+;; change bench-buffer-locals to check that.
+
+(load (expand-file-name "../etc/bench") nil t)
+
+(defvar bench-buffer-count 1000)
+(defvar bench-buffer-locals 50)
+(defvar bench-buffer-rounds 100)
+
+(let ((buffers nil) (i 0) (j 0) start sym)
+  (while (< i bench-buffer-count)
+    (set-buffer (get-buffer-create (format " bench-%d" i)))
+    (setq j 0)
+    (while (< j bench-buffer-locals)
+      (setq sym (intern (format "bench-local-%d" j)))
+      (make-local-variable sym)
+      (set sym i)
+      (setq j (1+ j)))
+    (make-local-variable 'indent-tabs-mode)
+    (setq indent-tabs-mode (= (% i 2) 0))
+    (make-local-variable 'scroll-step)
+    (setq scroll-step i)
+    (make-local-variable 'abbrev-all-caps)
+    (setq abbrev-all-caps nil)
+    (setq buffers (cons (current-buffer) buffers))
+    (setq i (1+ i)))
+
+  (setq start (bench-seconds) i 0)
+  (while (< i bench-buffer-rounds)
+    (setq j buffers)
+    (while j
+      (set-buffer (car j))
+      (setq j (cdr j)))
+    (setq i (1+ i)))
+  (message "%d switches among %d buffers with %d locals each: %d seconds"
+	   (* bench-buffer-rounds bench-buffer-count) bench-buffer-count
+	   bench-buffer-locals (bench-elapsed start)))
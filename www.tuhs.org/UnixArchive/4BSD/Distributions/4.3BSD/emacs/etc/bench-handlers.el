@@ -0,0 +1,83 @@
+;; Nested condition-case, catch and unwind-protect, run first as
+;; interpreted code and then byte-compiled.
+;; From the src directory:	emacs -batch -l ../etc/bench-handlers.el
+;; Run it with an emacs built before the handler changes and with one
+;; built after, and compare the seconds printed for each line.
+;; Every round sets up bench-handler-depth nested handlers around a
+;; trivial body.  The throw and signal lines also unwind all of them
+;; at once, from the innermost level to the outermost.
+
+(load (expand-file-name "../etc/bench") nil t)
+(load "bytecomp" nil t)
+
+(defvar bench-handler-depth 10)
+(defvar bench-handler-rounds 20000)
+(defvar bench-handler-count 0)
+
+(defun bench-condition-case (n)
+  (if (= n 0)
+      (setq bench-handler-count (1+ bench-handler-count))
+    (condition-case nil
+	(bench-condition-case (1- n))
+      (error nil))))
+
+(defun bench-catch (n)
+  (if (= n 0)
+      (setq bench-handler-count (1+ bench-handler-count))
+    (catch 'bench-tag
+      (bench-catch (1- n)))))
+
+(defun bench-unwind-protect (n)
+  (if (= n 0)
+      (setq bench-handler-count (1+ bench-handler-count))
+    (unwind-protect
+	(bench-unwind-protect (1- n))
+      (setq bench-handler-count (1+ bench-handler-count)))))
+
+(defun bench-throw (n)
+  (catch 'bench-outer
+    (bench-throw-1 n)))
+
+(defun bench-throw-1 (n)
+  (if (= n 0)
+      (throw 'bench-outer nil)
+    (catch 'bench-tag
+      (unwind-protect
+	  (bench-throw-1 (1- n))
+	(setq bench-handler-count (1+ bench-handler-count))))))
+
+(defun bench-signal (n)
+  (condition-case nil
+      (bench-signal-1 n)
+    (error nil)))
+
+(defun bench-signal-1 (n)
+  (if (= n 0)
+      (signal 'error nil)
+    (condition-case nil
+	(bench-signal-1 (1- n))
+      (arith-error nil))))
+
+(defun bench-handler-run (how function)
+  (let ((i 0) (start (bench-seconds)))
+    (while (< i bench-handler-rounds)
+      (funcall function bench-handler-depth)
+      (setq i (1+ i)))
+    (message "%s %s: %d rounds %d deep: %d seconds"
+	     how (symbol-name function) bench-handler-rounds bench-handler-depth
+	     (bench-elapsed start))))
+
+(defvar bench-handler-functions
+  '(bench-condition-case bench-catch bench-unwind-protect
+    bench-throw bench-throw-1 bench-signal bench-signal-1))
+
+(defun bench-handlers (how)
+  (bench-handler-run how 'bench-condition-case)
+  (bench-handler-run how 'bench-catch)
+  (bench-handler-run how 'bench-unwind-protect)
+  (bench-handler-run how 'bench-throw)
+  (bench-handler-run how 'bench-signal))
+
+(bench-handlers "interpreted")
+(mapcar 'byte-compile bench-handler-functions)
+(bench-handlers "compiled")
@@ -0,0 +1,34 @@
+;; Count lines with scan-buffer, which runs the same loop that
+;; indentation and redisplay use to find line boundaries.
+;; From the src directory:	emacs -batch -l ../etc/bench-lines.el
+;; Compare the seconds printed by two builds of emacs.
+;; Positions are 24-bit numbers, so no buffer reaches a gigabyte;
+;; instead a 4 megabyte buffer with the gap in the middle is scanned
+;; 256 times each way, a gigabyte in each direction.
+
+(load (expand-file-name "../etc/bench") nil t)
+
+(defvar bench-lines-rounds 256)
+
+(set-buffer (get-buffer-create " bench-lines"))
+(erase-buffer)
+(insert "The quick brown fox jumps over the lazy dog; 0123456789 ABCD\n")
+(while (< (buffer-size) 4000000)
+  (insert (buffer-substring 1 (1+ (buffer-size)))))
+;; Put the gap in the middle, so both halves are scanned.
+(goto-char (/ (buffer-size) 2))
+(insert "\n")
+
+(let ((i 0) (end (1+ (buffer-size))) start lines)
+  (setq start (bench-seconds))
+  (while (< i bench-lines-rounds)
+    (setq lines (scan-buffer 1 8000000 ?\n))
+    (setq i (1+ i)))
+  (message "forward: %d rounds over %d characters: %d seconds"
+	   bench-lines-rounds (buffer-size) (bench-elapsed start))
+  (setq start (bench-seconds) i 0)
+  (while (< i bench-lines-rounds)
+    (setq lines (scan-buffer end -8000000 ?\n))
+    (setq i (1+ i)))
+  (message "backward: %d rounds over %d characters: %d seconds"
+	   bench-lines-rounds (buffer-size) (bench-elapsed start)))
@@ -0,0 +1,16 @@
+;; Timing helpers shared by the bench-*.el scripts in this directory.
+;; Each script loads this file itself; see the top of each for how to
+;; run it.
+
+(defun bench-seconds ()
+  "Seconds since midnight, from current-time-string.
+That is the finest clock Lisp can read, so a timed loop should run
+for many seconds."
+  (let ((time (current-time-string)))
+    (+ (* 3600 (string-to-int (substring time 11 13)))
+       (* 60 (string-to-int (substring time 14 16)))
+       (string-to-int (substring time 17 19)))))
+
+(defun bench-elapsed (start)
+  "Seconds since START, a value of bench-seconds, across midnight too."
+  (% (+ 86400 (- (bench-seconds) start)) 86400))
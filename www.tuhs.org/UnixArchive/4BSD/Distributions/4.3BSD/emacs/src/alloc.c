@@ -25,6 +25,9 @@ and this notice must be preserved on all copies.  */
 #include "buffer.h"
 #include "window.h"
 #endif
+#include <setjmp.h>
+#include "regex.h"
+#include "thread.h"
 
 /* Number of bytes of consing done since the last gc */
 int consing_since_gc;
@@ -325,6 +328,7 @@ Its value and function definition are void, and its property list is NIL.")
   XSYMBOL (val)->value = Qunbound;
   XSYMBOL (val)->function = Qunbound;
   XSYMBOL (val)->next = 0;
+  XSYMBOL (val)->hash = 0;
   consing_since_gc += sizeof (struct Lisp_Symbol);
   return val;
 }
@@ -428,7 +432,6 @@ init_strings ()
   current_string_block->pos = 0;
 }
 
-static Lisp_Object make_zero_string ();
 
 DEFUN ("make-string", Fmake_string, Smake_string, 2, 2, 0,
   "Return a newly created string of length LENGTH, with each element being INIT.\n\
@@ -436,10 +439,18 @@ Both LENGTH and INIT must be numbers.")
   (length, init)
      Lisp_Object length, init;
 {
+  register Lisp_Object val;
+  register unsigned char *p, *end;
+
   if (XTYPE (length) != Lisp_Int || XINT (length) < 0)
     length = wrong_type_argument (Qnatnump, length);
   CHECK_NUMBER (init, 1);
-  return make_zero_string (XINT (length), XINT (init));
+  val = make_uninit_string (XINT (length));
+  p = XSTRING (val)->data;
+  end = p + XSTRING (val)->size;
+  while (p != end)
+    *p++ = XINT (init);
+  return val;
 }
 
 Lisp_Object
@@ -448,7 +459,7 @@ make_string (contents, length)
      int length;
 {
   Lisp_Object val;
-  val = make_zero_string (length, 0);
+  val = make_uninit_string (length);
   bcopy (contents, XSTRING (val)->data, length);
   return val;
 }
@@ -460,14 +471,15 @@ build_string (str)
   return make_string (str, strlen (str));
 }
 
-static Lisp_Object
-make_zero_string (length, init)
+/* Return a string of LENGTH characters whose contents
+   the caller will fill in.  Only the terminating zero is stored.  */
+
+Lisp_Object
+make_uninit_string (length)
      int length;
-     register int init;
 {
   register Lisp_Object val;
   register int fullsize = length + sizeof (int);
-  register unsigned char *p, *end;
 
   if (length < 0) abort ();
 
@@ -508,11 +520,7 @@ make_zero_string (length, init)
     }
     
   XSTRING (val)->size = length;
-  p = XSTRING (val)->data;
-  end = p + XSTRING (val)->size;
-  while (p != end)
-    *p++ = init;
-  *p = 0;
+  XSTRING (val)->data[length] = 0;
 
   return val;
 }
@@ -625,7 +633,7 @@ Does not copy symbols.")
 
 struct gcpro *gcprolist;
 
-#define NSTATICS 100
+#define NSTATICS 200
 
 char staticvec1[NSTATICS * sizeof (Lisp_Object *)] = {0};
 
@@ -680,7 +688,15 @@ int total_free_conses, total_free_markers, total_free_symbols;
 
 /* Garbage collection: mark and sweep, except copy strings. */
 static Lisp_Object mark_object ();
-static void clear_marks (), gc_sweep ();
+static void clear_marks (), gc_sweep (), mark_dynamic_state ();
+
+/* The thread whose dynamic state mark_dynamic_state is marking,
+   if that is not the running thread.  Pointers into its stack must
+   be translated to where the stack has been saved.  */
+
+static struct thread *gc_thread;
+
+#define GC_ADDR(type, p) ((type) thread_stack_addr (gc_thread, (char *) (p)))
 
 DEFUN ("garbage-collect", Fgarbage_collect, Sgarbage_collect, 0, 0, "",
   "Reclaim storage for Lisp objects no longer needed.\n\
@@ -693,11 +709,7 @@ gc-cons-threshold  bytes of Lisp data since previous garbage collection.")
 {
   struct string_block *old_string_block;
 
-  register struct gcpro *tail;
-  register struct specbinding *bind;
-  struct catchtag *catch;
-  struct handler *handler;
-  register struct backtrace *backlist;
+  register struct thread *t;
   register Lisp_Object tem;
   char *omessage = minibuf_message;
 
@@ -719,50 +731,31 @@ gc-cons-threshold  bytes of Lisp data since previous garbage collection.")
   total_string_size = 0;
   init_strings ();
 
-  for (tail = gcprolist; tail; tail = tail->next)
-    {
-      for (i = 0; i < tail->nvars; i++)
-	{
-	  tem = tail->var[i];
-	  tail->var[i] = mark_object (tem);
-	}
-    }
   for (i = 0; i < staticidx; i++)
     {
       tem = *staticvec[i];
       *staticvec[i] = mark_object (tem);
     }
-  for (bind = specpdl; bind != specpdl_ptr; bind++)
+  mark_dynamic_state (gcprolist, specpdl, specpdl_ptr,
+		      saved_positions, saved_positions_depth,
+		      catchlist, handlerlist, backtrace_list);
+
+  /* The threads that are not running keep the same things,
+     on stacks that have been copied elsewhere.  */
+  for (t = all_threads; t; t = t->next)
     {
-      bind->symbol = mark_object (bind->symbol);
-      bind->old_value = mark_object (bind->old_value);
+      t->object = mark_object (t->object);
+      if (t == current_thread || t->dead)
+	continue;
+      t->buffer = mark_object (t->buffer);
+      if (!t->started)
+	continue;
+      gc_thread = t;
+      mark_dynamic_state (t->gcprolist, t->specpdl, t->specpdl_ptr,
+			  t->saved_positions, t->saved_positions_depth,
+			  t->catchlist, t->handlerlist, t->backtrace_list);
+      gc_thread = 0;
     }
-  for (catch = catchlist; catch; catch = catch->next)
-    {
-      catch->tag = mark_object (catch->tag);
-      catch->val = mark_object (catch->val);
-    }  
-  for (handler = handlerlist; handler; handler = handler->next)
-    {
-      handler->handler = mark_object (handler->handler);
-      handler->var = mark_object (handler->var);
-    }  
-  for (backlist = backtrace_list; backlist; backlist = backlist->next)
-    {
-      tem = *backlist->function;
-      *backlist->function = mark_object (tem);
-      if (backlist->nargs == UNEVALLED || backlist->nargs == MANY)
-	{
-	  tem = *backlist->args;
-	  *backlist->args = mark_object (tem);
-	}
-      else
-	for (i = 0; i < backlist->nargs; i++)
-	  {
-	    tem = backlist->args[i];
-	    backlist->args[i] = mark_object (tem);
-	  }
-    }  
 
   gc_sweep (old_string_block);
 
@@ -789,6 +782,75 @@ gc-cons-threshold  bytes of Lisp data since previous garbage collection.")
 					    Qnil)))));
 }
 
+/* Mark the objects that a thread's gcpro list, specpdl, save-excursion
+   records, catches, condition handlers and backtrace refer to.  */
+
+static void
+mark_dynamic_state (gcpros, bind, bindend, positions, depth,
+		    catch, handler, backlist)
+     struct gcpro *gcpros;
+     register struct specbinding *bind, *bindend;
+     struct saved_position *positions;
+     int depth;
+     struct catchtag *catch;
+     struct handler *handler;
+     register struct backtrace *backlist;
+{
+  register struct gcpro *tail;
+  register Lisp_Object *var;
+  register Lisp_Object tem;
+  register int i;
+
+  for (tail = GC_ADDR (struct gcpro *, gcpros); tail;
+       tail = GC_ADDR (struct gcpro *, tail->next))
+    {
+      var = GC_ADDR (Lisp_Object *, tail->var);
+      for (i = 0; i < tail->nvars; i++)
+	{
+	  tem = var[i];
+	  var[i] = mark_object (tem);
+	}
+    }
+  for (; bind != bindend; bind++)
+    {
+      bind->symbol = mark_object (bind->symbol);
+      bind->old_value = mark_object (bind->old_value);
+    }
+  for (i = 0; i < depth; i++)
+    positions[i].buffer = mark_object (positions[i].buffer);
+  for (catch = GC_ADDR (struct catchtag *, catch); catch;
+       catch = GC_ADDR (struct catchtag *, catch->next))
+    {
+      catch->tag = mark_object (catch->tag);
+      catch->val = mark_object (catch->val);
+    }  
+  for (handler = GC_ADDR (struct handler *, handler); handler;
+       handler = GC_ADDR (struct handler *, handler->next))
+    {
+      handler->handler = mark_object (handler->handler);
+      handler->var = mark_object (handler->var);
+    }  
+  for (backlist = GC_ADDR (struct backtrace *, backlist); backlist;
+       backlist = GC_ADDR (struct backtrace *, backlist->next))
+    {
+      var = GC_ADDR (Lisp_Object *, backlist->function);
+      tem = *var;
+      *var = mark_object (tem);
+      var = GC_ADDR (Lisp_Object *, backlist->args);
+      if (backlist->nargs == UNEVALLED || backlist->nargs == MANY)
+	{
+	  tem = *var;
+	  *var = mark_object (tem);
+	}
+      else
+	for (i = 0; i < backlist->nargs; i++)
+	  {
+	    tem = var[i];
+	    var[i] = mark_object (tem);
+	  }
+    }  
+}
+
 static void
 clear_marks ()
 {
@@ -920,6 +982,7 @@ mark_object (obj)
     case Lisp_Vector:
     case Lisp_Window:
     case Lisp_Process:
+    case Lisp_Keyword_Matcher:
       {
 	register struct Lisp_Vector *ptr = XVECTOR (obj);
 	register int size = ptr->size;
@@ -936,6 +999,36 @@ mark_object (obj)
       }
       break;
 
+    case Lisp_Hash_Table:
+      {
+	register struct Lisp_Hash_Table *ptr = XHASH_TABLE (obj);
+	register struct Lisp_Vector *kv;
+	register int i;
+	Lisp_Object tem;
+
+	if (ptr->size & most_negative_fixnum) break;   /* Already marked */
+	ptr->size |= most_negative_fixnum;
+	ptr->test = mark_object (ptr->test);
+	ptr->rehash = mark_object (ptr->rehash);
+
+	/* Mark the keys and values ourselves, so we can tell
+	   if a key moved.  Only strings move, and only tables
+	   that hash by address care.  */
+	kv = XVECTOR (ptr->key_and_value);
+	if (kv->size & most_negative_fixnum) break;
+	kv->size |= most_negative_fixnum;
+	for (i = 0; i < (kv->size & ~most_negative_fixnum); i += 2)
+	  {
+	    tem = mark_object (kv->contents[i]);
+	    if (!EQ (tem, kv->contents[i]) && !EQ (ptr->test, Qequal))
+	      ptr->rehash = Qt;
+	    kv->contents[i] = tem;
+	    tem = kv->contents[i + 1];
+	    kv->contents[i + 1] = mark_object (tem);
+	  }
+      }
+      break;
+
     case Lisp_Temp_Vector:
       {
 	register struct Lisp_Vector *ptr = XVECTOR (obj);
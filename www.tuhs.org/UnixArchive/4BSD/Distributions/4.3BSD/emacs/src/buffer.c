@@ -229,6 +229,7 @@ reset_buffer_local_variables(b)
   b->mode_line_format = Vdefault_mode_line_format;
   b->auto_fill_hook = Qnil;
   b->local_var_alist = Qnil;
+  b->local_fwd_mask = 0;
   b->ctl_arrow = default_ctl_arrow ? Qt : Qnil;
   b->truncate_lines = default_truncate_lines ? Qt : Qnil;
   b->selective_display = Qnil;
@@ -649,14 +650,39 @@ thus, the least likely buffer for \\[switch-to-buffer] to select by default.")
 extern int last_known_column_point;
 
 /* set the current buffer to p */
+/* Look down the list ALIST of local Lisp variables
+   to find and update any that forward into C variables.
+   Used only when there are too many such variables for
+   the buffers' local_fwd_mask.  */
+
+static
+swap_fwd_locals (alist)
+     Lisp_Object alist;
+{
+  register Lisp_Object tail, valcontents;
+  enum Lisp_Type tem;
+
+  for (tail = alist; !NULL (tail); tail = XCONS (tail)->cdr)
+    {
+      valcontents = XSYMBOL (XCONS (XCONS (tail)->car)->car)->value;
+      if ((XTYPE (valcontents) == Lisp_Buffer_Local_Value
+	   || XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
+	  && (tem = XTYPE (XCONS (valcontents)->car),
+	      (tem == Lisp_Boolfwd || tem == Lisp_Intfwd
+	       || tem == Lisp_Objfwd)))
+	Fsymbol_value (XCONS (XCONS (tail)->car)->car);
+    }
+}
+
 SetBfp (p)
      register struct buffer *p;
 {
   register struct buffer *c = bf_cur;
   register struct window *w = XWINDOW (selected_window);
   register struct buffer *swb;
-  Lisp_Object tail, valcontents;
-  enum Lisp_Type tem;
+  Lisp_Object valcontents;
+  register unsigned mask;
+  register int i;
 
   if (c == p)
     return;
@@ -705,37 +731,24 @@ SetBfp (p)
 	abort ();
     }
 
-  /* Look down buffer's list of local Lisp variables
-     to find and update any that forward into C variables. */
+  /* Update the C variables that have local values in either buffer.
+     Other local variables are brought up to date by Fsymbol_value
+     and Fset when they are next used.  */
 
-  for (tail = p->local_var_alist; !NULL (tail); tail = XCONS (tail)->cdr)
+  mask = p->local_fwd_mask | (c ? c->local_fwd_mask : 0);
+  if (mask & LOCAL_FWD_OVERFLOW)
     {
-      valcontents = XSYMBOL (XCONS (XCONS (tail)->car)->car)->value;
-      if ((XTYPE (valcontents) == Lisp_Buffer_Local_Value
-	   || XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
-	  && (tem = XTYPE (XCONS (valcontents)->car),
-	      (tem == Lisp_Boolfwd || tem == Lisp_Intfwd
-	       || tem == Lisp_Objfwd)))
-	/* Just reference the variable
-	     to cause it to become set for this buffer.  */
-	Fsymbol_value (XCONS (XCONS (tail)->car)->car);
+      swap_fwd_locals (p->local_var_alist);
+      if (c)
+	swap_fwd_locals (c->local_var_alist);
     }
+  else
+    for (i = 0; mask; i++, mask >>= 1)
+      if (mask & 1)
+	/* Just reference the variable
+	   to cause it to become set for this buffer.  */
+	Fsymbol_value (local_fwd_syms[i]);
 
-  /* Do the same with any others that were local to the previous buffer */
-
-  if (c)
-    for (tail = c->local_var_alist; !NULL (tail); tail = XCONS (tail)->cdr)
-      {
-	valcontents = XSYMBOL (XCONS (XCONS (tail)->car)->car)->value;
-	if ((XTYPE (valcontents) == Lisp_Buffer_Local_Value
-	     || XTYPE (valcontents) == Lisp_Some_Buffer_Local_Value)
-	    && (tem = XTYPE (XCONS (valcontents)->car),
-		(tem == Lisp_Boolfwd || tem == Lisp_Intfwd
-		 || tem == Lisp_Objfwd)))
-	  /* Just reference the variable
-               to cause it to become set for this buffer.  */
-	  Fsymbol_value (XCONS (XCONS (tail)->car)->car);
-      }
   /* Vcheck_symbol is set up to the symbol paragraph-start
      in order to check for the bug that clobbers it.  */
   if (EQ (p->major_mode, Qlisp_mode)
@@ -92,6 +92,9 @@ struct buffer
   /* Alist of elements (SYMBOL . VALUE-IN-THIS-BUFFER)
      for all per-buffer variables of this buffer.  */
     Lisp_Object local_var_alist;
+    /* One bit for each variable in local_var_alist whose value
+       forwards into a C variable; see local_fwd_bit in data.c.  */
+    int local_fwd_mask;
 
     /* Position in buffer at which display started
        the last time this buffer was displayed */
@@ -143,3 +146,33 @@ extern struct buffer_text bf_text;
 #define CharAt(n) *(((n)>bf_s1 ? bf_p2 : bf_p1) + (n))
 
 extern void reset_buffer ();
+
+/* A record of an active save-excursion or save-restriction;
+   see editfns.c.  */
+
+struct saved_position
+  {
+    int pdlcount;		/* specpdl depth when the record was made */
+    Lisp_Object buffer;		/* For save-restriction, the buffer */
+    int head_clip, tail_clip;	/* and its restriction */
+    struct Lisp_Marker pointm;	/* For save-excursion, point */
+    struct Lisp_Marker markm;	/* and the mark, if has_mark */
+    char has_mark;
+    char visible;		/* Nonzero if buffer was in selected window */
+  };
+
+#define SAVED_POSITION_MAX 64
+
+extern struct saved_position *saved_positions;
+extern int saved_positions_depth;
+
+/* Symbols of the C variables that have been made buffer-local,
+   indexed by their bit number in a buffer's local_fwd_mask.
+   If there are more than MAX_LOCAL_FWD of them, the others
+   all share the bit LOCAL_FWD_OVERFLOW.  */
+
+#define MAX_LOCAL_FWD 31
+#define LOCAL_FWD_OVERFLOW 020000000000
+
+extern Lisp_Object local_fwd_syms[];
+extern int local_fwd_bit ();
@@ -143,6 +143,501 @@ Lisp_Object Qbytecode;
 
 #define TOP (*stackp)
 
+/* At a jump, let a background thread give way now and then, as
+   Feval does.  Only the live part of the stack is protected meanwhile.  */
+
+#define PREEMPT \
+  if (thread_countdown && !--thread_countdown) \
+    { gcpro3.nvars = &TOP - stack; \
+      thread_preempt (); \
+      gcpro3.nvars = XFASTINT (maxdepth); }
+
+
+/* Peephole optimizer.
+
+   The first time a piece of byte code is executed, optimize_byte_code
+   decodes it into an array of instructions, repeatedly rewrites
+   redundant sequences, and encodes the result into a new string,
+   adding a new constants vector if folding produced new constants.
+   The result is remembered in byte_code_cache, keyed by the original
+   constants vector (vectors never move, unlike strings), as
+   (BYTESTR NEWSTR . NEWVECTOR), or (BYTESTR) if nothing changed.
+
+   Transformations:
+     jump to goto or to a chain of same-sense conditional jumps:
+	jump directly to the final destination;
+     goto to return, or to the next instruction: return, or nothing;
+     dup discard, constant discard: nothing;
+     constant, conditional jump: goto or nothing;
+     constant arithmetic and comparisons: one constant.
+   varref X varset X is left alone: it signals if X is void, and
+   it makes X buffer-local if X is automatically buffer-local.
+
+   Any change must leave the stack depth at every point no greater
+   than before, since maxdepth is computed by the compiler.  */
+
+Lisp_Object Vbyte_code_cache;
+int byte_code_optimize;
+
+/* Flush byte_code_cache when it gets bigger than this,
+   so that code of redefined functions is eventually freed.  */
+
+#define BYTE_CODE_CACHE_MAX 2000
+
+
+struct binsn
+  {
+    short op;			/* Base opcode, or -1 if deleted */
+    char is_target;		/* Nonzero if some jump lands here */
+    int arg;			/* Operand; for jumps, insn index of target */
+    int newpc;			/* Offset in the encoded string */
+  };
+
+/* Nonzero for the opcodes 010 through 057 whose low 3 bits
+   encode the operand or say where to fetch it.  */
+
+#define OPERAND_OP(op) ((op) >= Bvarref && (op) < Bunbind + 8)
+
+#define JUMP_OP(op) ((op) >= Bgoto && (op) <= Bgotoifnonnilelsepop)
+
+/* State of one optimization run.  */
+
+static struct binsn *bo_insns;
+static int bo_ninsns;
+static Lisp_Object bo_vector;
+static Lisp_Object bo_new_constants;	/* List, most recent first */
+static int bo_nconstants;
+
+/* Index of the first live instruction at or after I, or bo_ninsns.  */
+
+static int
+bo_live (i)
+     register int i;
+{
+  while (i < bo_ninsns && bo_insns[i].op < 0)
+    i++;
+  return i;
+}
+
+/* Return the index in the (extended) constants vector of VAL,
+   adding it if necessary, or -1 if that would need too many.  */
+
+static int
+bo_constant (val)
+     Lisp_Object val;
+{
+  register int i;
+  register int size = XVECTOR (bo_vector)->size;
+  register Lisp_Object tail;
+
+  for (i = 0; i < size; i++)
+    if (EQ (XVECTOR (bo_vector)->contents[i], val))
+      return i;
+  for (tail = bo_new_constants, i = size + bo_nconstants - 1;
+       !NULL (tail); tail = XCONS (tail)->cdr, i--)
+    if (EQ (XCONS (tail)->car, val))
+      return i;
+  if (size + bo_nconstants >= 0x10000)
+    return -1;
+  bo_new_constants = Fcons (val, bo_new_constants);
+  return size + bo_nconstants++;
+}
+
+/* Return the value of constant insn I.  */
+
+static Lisp_Object
+bo_constant_value (i)
+     int i;
+{
+  register int n = bo_insns[i].arg - XVECTOR (bo_vector)->size;
+  register Lisp_Object tail;
+
+  if (n < 0)
+    return XVECTOR (bo_vector)->contents[bo_insns[i].arg];
+  for (tail = bo_new_constants, n = bo_nconstants - 1 - n; n > 0; n--)
+    tail = XCONS (tail)->cdr;
+  return XCONS (tail)->car;
+}
+
+/* Try to fold constants I and J with binary operator OP.
+   Return 1 and store the result in *VALP if possible.  */
+
+static int
+bo_fold2 (op, i, j, valp)
+     int op, i, j;
+     Lisp_Object *valp;
+{
+  Lisp_Object v1, v2;
+  register int a, b;
+
+  v1 = bo_constant_value (i);
+  v2 = bo_constant_value (j);
+  if (XTYPE (v1) != Lisp_Int || XTYPE (v2) != Lisp_Int)
+    return 0;
+  a = XINT (v1), b = XINT (v2);
+  switch (op)
+    {
+    case Bplus:   *valp = make_number (a + b); break;
+    case Bdiff:   *valp = make_number (a - b); break;
+    case Bmax:    *valp = make_number (a > b ? a : b); break;
+    case Bmin:    *valp = make_number (a < b ? a : b); break;
+    case Beqlsign: *valp = a == b ? Qt : Qnil; break;
+    case Bgtr:    *valp = a > b ? Qt : Qnil; break;
+    case Blss:    *valp = a < b ? Qt : Qnil; break;
+    case Bleq:    *valp = a <= b ? Qt : Qnil; break;
+    case Bgeq:    *valp = a >= b ? Qt : Qnil; break;
+    default:
+      return 0;
+    }
+  return 1;
+}
+
+/* Make insn I push constant VAL.  Return 0 if out of constants.  */
+
+static int
+bo_set_constant (i, val)
+     int i;
+     Lisp_Object val;
+{
+  register int n = bo_constant (val);
+
+  if (n < 0)
+    return 0;
+  bo_insns[i].op = Bconstant;
+  bo_insns[i].arg = n;
+  return 1;
+}
+
+/* Return the final destination of a jump with opcode OP to insn T,
+   following gotos and jumps that are certain to be taken.
+   Store into *OPP the opcode the jump should then have.  */
+
+static int
+bo_thread (op, t, opp)
+     register int op, t;
+     int *opp;
+{
+  register int top, steps;
+
+  for (steps = 0; steps < 20; steps++)
+    {
+      t = bo_live (t);
+      if (t >= bo_ninsns)
+	break;
+      top = bo_insns[t].op;
+      if (top == Bgoto)
+	;
+      /* If the value was nil, the next nil-testing jump is taken too.  */
+      else if (op == Bgotoifnilelsepop
+	       && (top == Bgotoifnilelsepop || top == Bgotoifnil))
+	op = top;
+      else if (op == Bgotoifnonnilelsepop
+	       && (top == Bgotoifnonnilelsepop || top == Bgotoifnonnil))
+	op = top;
+      else
+	break;
+      t = bo_insns[t].arg;
+    }
+  *opp = op;
+  return t;
+}
+
+/* Do one pass over the code.  Return nonzero if anything changed.  */
+
+static int
+bo_pass ()
+{
+  register struct binsn *in = bo_insns;
+  register int i, j, k, op;
+  int changed = 0, newop, t;
+  Lisp_Object val;
+
+  for (i = 0; i < bo_ninsns; i++)
+    in[i].is_target = 0;
+  for (i = 0; i < bo_ninsns; i++)
+    if (in[i].op >= 0 && JUMP_OP (in[i].op))
+      {
+	t = bo_live (in[i].arg);
+	if (t < bo_ninsns)
+	  in[t].is_target = 1;
+      }
+
+  for (i = bo_live (0); i < bo_ninsns; i = bo_live (i + 1))
+    {
+      op = in[i].op;
+      j = bo_live (i + 1);
+      k = j < bo_ninsns ? bo_live (j + 1) : j;
+
+      if (JUMP_OP (op))
+	{
+	  t = bo_thread (op, in[i].arg, &newop);
+	  if (bo_live (t) != bo_live (in[i].arg) || newop != op)
+	    {
+	      in[i].op = newop, in[i].arg = t;
+	      changed = 1;
+	    }
+	  t = bo_live (t);
+	  if (t == j && in[i].op == Bgoto)
+	    {
+	      in[i].op = -1;
+	      changed = 1;
+	    }
+	  else if (t == j
+		   && (in[i].op == Bgotoifnil || in[i].op == Bgotoifnonnil))
+	    {
+	      in[i].op = Bdiscard;
+	      changed = 1;
+	    }
+	  else if (in[i].op == Bgoto && t < bo_ninsns
+		   && in[t].op == Breturn)
+	    {
+	      in[i].op = Breturn;
+	      changed = 1;
+	    }
+	  continue;
+	}
+
+      if (j >= bo_ninsns || in[j].is_target)
+	continue;
+
+      if ((op == Bdup || op == Bconstant) && in[j].op == Bdiscard)
+	{
+	  in[i].op = in[j].op = -1;
+	  changed = 1;
+	}
+      else if (op != Bconstant)
+	;
+      else if (JUMP_OP (in[j].op) && in[j].op != Bgoto)
+	{
+	  /* Decide a conditional jump on a constant.
+	     For the elsepop jumps, the constant stays on the stack
+	     if the jump is taken.  */
+	  int isnil = NULL (bo_constant_value (i));
+	  int taken = (in[j].op == Bgotoifnil
+		       || in[j].op == Bgotoifnilelsepop) ? isnil : !isnil;
+	  int keep = (in[j].op == Bgotoifnilelsepop
+		      || in[j].op == Bgotoifnonnilelsepop);
+
+	  if (!taken)
+	    in[i].op = in[j].op = -1;
+	  else
+	    {
+	      in[j].op = Bgoto;
+	      if (!keep)
+		in[i].op = -1;
+	    }
+	  changed = 1;
+	}
+      else if (in[j].op == Badd1 || in[j].op == Bsub1
+	       || in[j].op == Bnegate || in[j].op == Bnot)
+	{
+	  val = bo_constant_value (i);
+	  if (in[j].op == Bnot)
+	    val = NULL (val) ? Qt : Qnil;
+	  else if (XTYPE (val) != Lisp_Int)
+	    continue;
+	  else if (in[j].op == Badd1)
+	    val = make_number (XINT (val) + 1);
+	  else if (in[j].op == Bsub1)
+	    val = make_number (XINT (val) - 1);
+	  else
+	    val = make_number (- XINT (val));
+	  if (bo_set_constant (i, val))
+	    {
+	      in[j].op = -1;
+	      changed = 1;
+	    }
+	}
+      else if (in[j].op == Bconstant && k < bo_ninsns && !in[k].is_target
+	       && bo_fold2 (in[k].op, i, j, &val)
+	       && bo_set_constant (i, val))
+	{
+	  in[j].op = in[k].op = -1;
+	  changed = 1;
+	}
+    }
+  return changed;
+}
+
+/* Return the length of the encoding of insn I.  */
+
+static int
+bo_length (i)
+     int i;
+{
+  register int op = bo_insns[i].op, arg = bo_insns[i].arg;
+
+  if (op < 0)
+    return 0;
+  if (OPERAND_OP (op))
+    return arg < 6 ? 1 : arg < 0400 ? 2 : 3;
+  if (op == Bconstant)
+    return arg < CONSTANTLIM ? 1 : 3;
+  if (JUMP_OP (op))
+    return 3;
+  return 1;
+}
+
+/* Decode BYTESTR.  Return 0 if it contains anything not understood.  */
+
+static int
+bo_decode (bytestr)
+     Lisp_Object bytestr;
+{
+  register unsigned char *p = XSTRING (bytestr)->data;
+  register int len = XSTRING (bytestr)->size;
+  register int pc = 0, op, n = 0, i;
+  int *pcmap = (int *) alloca ((len + 1) * sizeof (int));
+
+  for (i = 0; i <= len; i++)
+    pcmap[i] = -1;
+
+  while (pc < len)
+    {
+      pcmap[pc] = n;
+      op = p[pc++];
+      bo_insns[n].arg = 0;
+      if (OPERAND_OP (op))
+	{
+	  bo_insns[n].op = op & ~7;
+	  if ((op & 7) < 6)
+	    bo_insns[n].arg = op & 7;
+	  else if ((op & 7) == 6 && pc < len)
+	    bo_insns[n].arg = p[pc++];
+	  else if (pc + 1 < len)
+	    bo_insns[n].arg = p[pc] + (p[pc + 1] << 8), pc += 2;
+	  else
+	    return 0;
+	}
+      else if (op >= Bconstant)
+	bo_insns[n].op = Bconstant, bo_insns[n].arg = op - Bconstant;
+      else if (op == Bconstant2 || JUMP_OP (op))
+	{
+	  if (pc + 1 >= len)
+	    return 0;
+	  bo_insns[n].op = op == Bconstant2 ? Bconstant : op;
+	  bo_insns[n].arg = p[pc] + (p[pc + 1] << 8), pc += 2;
+	}
+      else if ((op >= Bnth && op <= Bmin)
+	       || (op >= Bpoint && op <= Binteractive_p)
+	       || (op >= Breturn && op <= Btemp_output_buffer_show))
+	bo_insns[n].op = op;
+      else
+	return 0;
+      n++;
+    }
+  bo_ninsns = n;
+
+  /* Convert jump targets to instruction indices.  */
+  for (i = 0; i < n; i++)
+    if (JUMP_OP (bo_insns[i].op))
+      {
+	if (bo_insns[i].arg >= len || pcmap[bo_insns[i].arg] < 0)
+	  return 0;
+	bo_insns[i].arg = pcmap[bo_insns[i].arg];
+      }
+    else if (bo_insns[i].op == Bconstant
+	     && bo_insns[i].arg >= XVECTOR (bo_vector)->size)
+      return 0;
+  return 1;
+}
+
+/* Encode the instructions into a new string.  */
+
+static Lisp_Object
+bo_encode ()
+{
+  register struct binsn *in = bo_insns;
+  register int i, pc, op, arg;
+  register unsigned char *p;
+  Lisp_Object str;
+
+  for (i = 0, pc = 0; i < bo_ninsns; i++)
+    {
+      in[i].newpc = pc;
+      pc += bo_length (i);
+    }
+  str = make_uninit_string (pc);
+  p = XSTRING (str)->data;
+
+  for (i = 0; i < bo_ninsns; i++)
+    {
+      op = in[i].op, arg = in[i].arg;
+      if (op < 0)
+	continue;
+      if (JUMP_OP (op))
+	{
+	  arg = bo_live (arg);
+	  arg = arg < bo_ninsns ? in[arg].newpc : pc;
+	  *p++ = op;
+	  *p++ = arg, *p++ = arg >> 8;
+	}
+      else if (OPERAND_OP (op))
+	{
+	  if (arg < 6)
+	    *p++ = op + arg;
+	  else if (arg < 0400)
+	    *p++ = op + 6, *p++ = arg;
+	  else
+	    *p++ = op + 7, *p++ = arg, *p++ = arg >> 8;
+	}
+      else if (op == Bconstant && arg >= CONSTANTLIM)
+	*p++ = Bconstant2, *p++ = arg, *p++ = arg >> 8;
+      else if (op == Bconstant)
+	*p++ = Bconstant + arg;
+      else
+	*p++ = op;
+    }
+  return str;
+}
+
+/* Return the cache entry for BYTESTR and VECTOR, optimizing if needed.  */
+
+static Lisp_Object
+optimize_byte_code (bytestr, vector)
+     Lisp_Object bytestr, vector;
+{
+  Lisp_Object entry, newvec, tail;
+  register int i, changed = 0;
+
+  entry = Fgethash (vector, Vbyte_code_cache, Qnil);
+  if (!NULL (entry) && EQ (XCONS (entry)->car, bytestr))
+    return entry;
+
+  bo_vector = vector;
+  bo_new_constants = Qnil;
+  bo_nconstants = 0;
+  bo_insns = (struct binsn *) alloca ((XSTRING (bytestr)->size + 1)
+				      * sizeof (struct binsn));
+
+  if (bo_decode (bytestr))
+    for (i = 0; i < 10 && bo_pass (); i++)
+      changed = 1;
+
+  if (!changed)
+    entry = Fcons (bytestr, Qnil);
+  else
+    {
+      newvec = vector;
+      if (bo_nconstants)
+	{
+	  i = XVECTOR (vector)->size;
+	  newvec = Fmake_vector (make_number (i + bo_nconstants), Qnil);
+	  bcopy (XVECTOR (vector)->contents, XVECTOR (newvec)->contents,
+		 i * sizeof (Lisp_Object));
+	  for (tail = bo_new_constants, i += bo_nconstants - 1;
+	       !NULL (tail); tail = XCONS (tail)->cdr, i--)
+	    XVECTOR (newvec)->contents[i] = XCONS (tail)->car;
+	}
+      entry = Fcons (bytestr, Fcons (bo_encode (), newvec));
+    }
+  bo_vector = bo_new_constants = Qnil;
+
+  if (XFASTINT (Fhash_table_count (Vbyte_code_cache)) >= BYTE_CODE_CACHE_MAX)
+    Fclrhash (Vbyte_code_cache);
+  Fputhash (vector, entry, Vbyte_code_cache);
+  return entry;
+}
 
 DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
   "")
@@ -164,6 +659,17 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
     vector = wrong_type_argument (Qvectorp, vector);
   CHECK_NUMBER (maxdepth, 2);
 
+  if (byte_code_optimize)
+    {
+      v1 = optimize_byte_code (bytestr, vector);
+      if (!NULL (XCONS (v1)->cdr))
+	{
+	  bytestr = XCONS (XCONS (v1)->cdr)->car;
+	  vector = XCONS (XCONS (v1)->cdr)->cdr;
+	  vectorp = XVECTOR (vector)->contents;
+	}
+    }
+
   stackp = (Lisp_Object *) alloca (XFASTINT (maxdepth) * sizeof (Lisp_Object));
   bzero (stackp, XFASTINT (maxdepth) * sizeof (Lisp_Object));
   GCPRO3 (bytestr, vector, *stackp);
@@ -253,12 +759,14 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 
 	case Bgoto:
 	  QUIT;
+	  PREEMPT;
 	  op = FETCH2;    /* pc = FETCH2 loses since FETCH2 contains pc++ */
 	  pc = op;
 	  break;
 
 	case Bgotoifnil:
 	  QUIT;
+	  PREEMPT;
 	  op = FETCH2;
 	  if (NULL (POP))
 	    pc = op;
@@ -266,6 +774,7 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 
 	case Bgotoifnonnil:
 	  QUIT;
+	  PREEMPT;
 	  op = FETCH2;
 	  if (!NULL (POP))
 	    pc = op;
@@ -273,6 +782,7 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 
 	case Bgotoifnilelsepop:
 	  QUIT;
+	  PREEMPT;
 	  op = FETCH2;
 	  if (NULL (TOP))
 	    pc = op;
@@ -281,6 +791,7 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 
 	case Bgotoifnonnilelsepop:
 	  QUIT;
+	  PREEMPT;
 	  op = FETCH2;
 	  if (!NULL (TOP))
 	    pc = op;
@@ -328,8 +839,8 @@ DEFUN ("byte-code", Fbyte_code, Sbyte_code, 3, 3, 0,
 
 	case Bcondition_case:
 	  v1 = POP;
-	  v1 = Fcons (POP, v1);
-	  TOP = Fcondition_case (Fcons (TOP, v1));
+	  v2 = POP;
+	  TOP = internal_lisp_condition_case (TOP, v2, v1);
 	  break;
 
 	case Btemp_output_buffer_setup:
@@ -675,6 +1186,18 @@ syms_of_bytecode ()
   Qbytecode = intern ("byte-code");
   staticpro (&Qbytecode);
 
+  Vbyte_code_cache = Fmake_hash_table (Qeq, Qnil);
+  staticpro (&Vbyte_code_cache);
+  staticpro (&bo_vector);
+  bo_vector = Qnil;
+  staticpro (&bo_new_constants);
+  bo_new_constants = Qnil;
+
+  DefBoolVar ("byte-code-optimize", &byte_code_optimize,
+    "*Non-nil means optimize byte code the first time it is run.\n\
+The optimized code is remembered, so this costs nothing afterward.");
+  byte_code_optimize = 1;
+
   defsubr (&Sbyte_code);
 }
 
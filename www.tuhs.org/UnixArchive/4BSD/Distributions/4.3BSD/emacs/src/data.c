@@ -641,6 +641,7 @@ DEFUN ("set", Fset, Sset, 2, 2, 0,
 	      {
 		tem1 = Fcons (sym, Fcdr (current_alist_element));
 		bf_cur->local_var_alist = Fcons (tem1, bf_cur->local_var_alist);
+		bf_cur->local_fwd_mask |= local_fwd_bit (sym);
 	      }
 	  XCONS (XCONS (XCONS (valcontents)->cdr)->cdr)->car = tem1;
 	  XSET (XCONS (XCONS (valcontents)->cdr)->car, Lisp_Buffer, bf_cur);
@@ -678,6 +679,41 @@ for this variable.")
   return value;
 }
 
+/* Buffer-local values of C variables have to be swapped in when
+   the current buffer changes, since C code uses the variables directly.
+   Each such variable gets a bit in local_fwd_mask, so that SetBfp
+   need look only at the variables local in the buffers involved.  */
+
+Lisp_Object local_fwd_syms[MAX_LOCAL_FWD];
+int n_local_fwd;
+
+/* Return the local_fwd_mask bit for SYM,
+   or 0 if SYM is not a buffer-local C variable.  */
+
+int
+local_fwd_bit (sym)
+     Lisp_Object sym;
+{
+  register Lisp_Object valcontents = XSYMBOL (sym)->value;
+  register enum Lisp_Type tem;
+  register int i;
+
+  if (XTYPE (valcontents) != Lisp_Buffer_Local_Value
+      && XTYPE (valcontents) != Lisp_Some_Buffer_Local_Value)
+    return 0;
+  tem = XTYPE (XCONS (valcontents)->car);
+  if (tem != Lisp_Boolfwd && tem != Lisp_Intfwd && tem != Lisp_Objfwd)
+    return 0;
+
+  for (i = 0; i < n_local_fwd; i++)
+    if (EQ (local_fwd_syms[i], sym))
+      return 1 << i;
+  if (n_local_fwd == MAX_LOCAL_FWD)
+    return LOCAL_FWD_OVERFLOW;
+  local_fwd_syms[n_local_fwd] = sym;
+  return 1 << n_local_fwd++;
+}
+
 DEFUN ("make-variable-buffer-local", Fmake_variable_buffer_local, Smake_variable_buffer_local,
   1, 1, "vMake Variable Buffer Local: ",
   "Make VARIABLE have a separate value for each buffer.\n\
@@ -743,6 +779,7 @@ DEFUN ("make-local-variable", Fmake_local_variable, Smake_local_variable,
       bf_cur->local_var_alist
         = Fcons (Fcons (sym, XCONS (XCONS (XCONS (XSYMBOL (sym)->value)->cdr)->cdr)->cdr),
 		 bf_cur->local_var_alist);
+      bf_cur->local_fwd_mask |= local_fwd_bit (sym);
       /* Make sure symbol does not think it is set up for this buffer;
 	 force it to look once again for this buffer's value */
       if (bf_cur == XBUFFER (XCONS (XCONS (XSYMBOL (sym)->value)->cdr)->car))
@@ -772,6 +809,9 @@ From now on the default value will apply in this buffer.")
   tem = Fassq (sym, bf_cur->local_var_alist);
   if (!NULL (tem))
     bf_cur->local_var_alist = Fdelq (tem, bf_cur->local_var_alist);
+  /* An overflow bit stays; it only costs a slower switch.  */
+  if (local_fwd_bit (sym) != LOCAL_FWD_OVERFLOW)
+    bf_cur->local_fwd_mask &= ~local_fwd_bit (sym);
 
   /* Put the symbol into a consistent state,
      set up for access in the current buffer with the default value */
@@ -1109,7 +1109,9 @@ DEFUN ("sleep-for", Fsleep_for, Ssleep_for, 1, 1, 0,
 }
 
 DEFUN ("sit-for", Fsit_for, Ssit_for, 1, 1, 0,
-  "Perform redisplay, then wait for ARG seconds or until input is available")
+  "Perform redisplay, then wait for ARG seconds or until input is available.\n\
+Background threads run meanwhile.  In a background thread, just let the\n\
+other threads run, and come back after ARG seconds.")
   (n)
      Lisp_Object n;
 {
@@ -1121,36 +1123,59 @@ DEFUN ("sit-for", Fsit_for, Ssit_for, 1, 1, 0,
 #endif
   int waitchannels;
 #endif /* no subprocesses */
+  long end_time, now;
+  int wait;
 
   CHECK_NUMBER (n, 0);
 
+  if (in_background_thread ())
+    {
+      thread_sleep (XINT (n));
+      return Qnil;
+    }
+
   if (detect_input_pending ())
     return Qnil;
 
   DoDsp (1);			/* Make the screen correct */
   if (XINT (n) <= 0) return Qnil;
 
+  time (&end_time);
+  end_time += XINT (n);
+  while (1)
+    {
+      /* Let background threads run, then wait for the rest of the time,
+	 or until the first sleeping thread wakes,
+	 or not at all if some thread can go on at once.  */
+      wait = run_threads ();
+      time (&now);
+      if (detect_input_pending () || now >= end_time)
+	break;
+      if (wait == 0 || wait > end_time - now)
+	wait = end_time - now;
+
 #ifdef subprocesses
 #ifdef SIGIO
-  gobble_input ();
+      gobble_input ();
 #endif /* SIGIO */
-  wait_reading_process_input (XINT (n), 1, 1);
+      wait_reading_process_input (wait, 1, 1);
 #else /* no subprocesses */
-  immediate_quit = 1;
-  QUIT;
+      immediate_quit = 1;
+      QUIT;
 
-  waitchannels = 1;
+      waitchannels = 1;
 #ifndef HAVE_TIMEVAL
-  timeout_sec = XINT (n);
-  select (1, &waitchannels, 0, 0, &timeout_sec);
+      timeout_sec = wait < 0 ? 0 : wait;
+      select (1, &waitchannels, 0, 0, &timeout_sec);
 #else /* HAVE_TIMEVAL */
-  timeout.tv_sec = XINT (n);  
-  timeout.tv_usec = 0;
-  select (1, &waitchannels, 0, 0, &timeout);
+      timeout.tv_sec = wait < 0 ? 0 : wait;
+      timeout.tv_usec = 0;
+      select (1, &waitchannels, 0, 0, &timeout);
 #endif /* HAVE_TIMEVAL */
 
-  immediate_quit = 0;
+      immediate_quit = 0;
 #endif /* no subprocesses */
+    }
   return Qnil;
 }
 
@@ -242,12 +242,88 @@ Argument is character position, or nil to clear out the mark.")
   return pos;
 }
 
+/* Records of active save-excursion and save-restriction forms.
+   Each form takes the next free record and passes its index to its
+   unwind function through the specpdl, so records are released in
+   the same order as specpdl entries.  The markers of a record are
+   chained into the buffer only while the record is in use, so they
+   are relocated by insertion and deletion like any others, but they
+   are never allocated and leave nothing for gc to sweep.  Beyond
+   SAVED_POSITION_MAX nested forms, a marker or cons is allocated
+   as it used to be.  Each thread has its own records;
+   these are the main thread's.  */
+
+static struct saved_position main_saved_positions[SAVED_POSITION_MAX];
+struct saved_position *saved_positions = main_saved_positions;
+int saved_positions_depth;
+
+/* Release the records from DEPTH up.  */
+
+static
+release_saved_positions (depth)
+     int depth;
+{
+  register struct saved_position *rec;
+  Lisp_Object tem;
+
+  while (saved_positions_depth > depth)
+    {
+      rec = &saved_positions[--saved_positions_depth];
+      XSET (tem, Lisp_Marker, &rec->pointm);
+      unchain_marker (tem);
+      XSET (tem, Lisp_Marker, &rec->markm);
+      unchain_marker (tem);
+      rec->buffer = Qnil;
+    }
+}
+
+/* Return a free record, or 0 if there is none.
+   The caller must put the record's unwind function
+   into the specpdl immediately.  */
+
+static struct saved_position *
+new_saved_position ()
+{
+  register int count = specpdl_ptr - specpdl;
+  register struct saved_position *rec;
+
+  /* A record whose specpdl entry is gone was never used,
+     because record_unwind_protect got an error.  */
+  while (saved_positions_depth > 0
+	 && saved_positions[saved_positions_depth - 1].pdlcount >= count)
+    release_saved_positions (saved_positions_depth - 1);
+
+  if (saved_positions_depth == SAVED_POSITION_MAX)
+    return 0;
+  rec = &saved_positions[saved_positions_depth++];
+  rec->pdlcount = count;
+  rec->buffer = Qnil;
+  return rec;
+}
+
 Lisp_Object
 save_excursion_save ()
 {
   Lisp_Object oldpoint, oldmark;
+  register struct saved_position *rec;
   int visible = XBUFFER (XWINDOW (selected_window)->buffer) == bf_cur;
 
+  rec = new_saved_position ();
+  if (rec)
+    {
+      XSET (oldpoint, Lisp_Marker, &rec->pointm);
+      Fset_marker (oldpoint, make_number (point), Qnil);
+      rec->has_mark = (!NULL (bf_cur->mark)
+		       && XMARKER (bf_cur->mark)->buffer != 0);
+      if (rec->has_mark)
+	{
+	  XSET (oldmark, Lisp_Marker, &rec->markm);
+	  Fset_marker (oldmark, bf_cur->mark, Qnil);
+	}
+      rec->visible = visible;
+      return make_number (rec - saved_positions);
+    }
+
   oldpoint = Fpoint_marker ();
 
   if (!NULL (bf_cur->mark))
@@ -263,6 +339,41 @@ save_excursion_restore (info)
      Lisp_Object info;
 {
   Lisp_Object tem;
+  register struct saved_position *rec;
+  Lisp_Object buffer, mark;
+  int pos, visible;
+
+  if (XTYPE (info) == Lisp_Int)
+    {
+      /* Take everything out of the record and release it
+	 before anything can get an error.  */
+      rec = &saved_positions[XFASTINT (info)];
+      buffer = Qnil;
+      mark = Qnil;
+      if (rec->pointm.buffer != 0)
+	{
+	  XSET (buffer, Lisp_Buffer, rec->pointm.buffer);
+	  XSET (tem, Lisp_Marker, &rec->pointm);
+	  pos = marker_position (tem);
+	  if (rec->has_mark && rec->markm.buffer != 0)
+	    {
+	      XSET (tem, Lisp_Marker, &rec->markm);
+	      mark = make_number (marker_position (tem));
+	    }
+	}
+      visible = rec->visible;
+      release_saved_positions (XFASTINT (info));
+
+      /* If buffer being returned to is now deleted, avoid error */
+      if (NULL (buffer))
+	return Qnil;
+      Fset_buffer (buffer);
+      Fgoto_char (make_number (pos));
+      Fset_mark (mark);
+      if (visible && bf_cur != XBUFFER (XWINDOW (selected_window)->buffer))
+	Fswitch_to_buffer (Fcurrent_buffer (), Qnil);
+      return Qnil;
+    }
 
   tem = Fmarker_buffer (Fcar (info));
   /* If buffer being returned to is now deleted, avoid error */
@@ -476,6 +587,30 @@ get relocated to point after the newly inserted text.")
   return Qnil;
 }
 
+/* Return a string with the characters of the current buffer from
+   BEG up to END.  A region that spans the gap is copied in two pieces
+   rather than moving the gap, which could mean shifting far more text
+   than the region contains.  */
+
+Lisp_Object
+make_buffer_string (beg, end)
+     register int beg, end;
+{
+  register Lisp_Object val;
+  register int len1 = 0;
+
+  val = make_uninit_string (end - beg);
+  if (beg <= bf_s1)
+    {
+      len1 = (end <= bf_s1 ? end : bf_s1 + 1) - beg;
+      bcopy (bf_p1 + beg, XSTRING (val)->data, len1);
+    }
+  if (end - beg > len1)
+    bcopy (bf_p2 + beg + len1, XSTRING (val)->data + len1,
+	   end - beg - len1);
+  return val;
+}
+
 /* Return a string with the contents of the current region */
 
 DEFUN ("buffer-substring", Fbuffer_substring, Sbuffer_substring, 2, 2, 0,
@@ -490,18 +625,14 @@ The two arguments specify the start and end, as character numbers.")
   beg = XINT (b);
   end = XINT (e);
 
-  if (beg <= bf_s1 && end > bf_s1)
-      GapTo (beg);
-  return make_string (&CharAt (beg), end - beg);
+  return make_buffer_string (beg, end);
 }
 
 DEFUN ("buffer-string", Fbuffer_string, Sbuffer_string, 0, 0, 0,
   "Return the contents of the current buffer as a string.")
   ()
 {
-  if (FirstCharacter <= bf_s1 && NumCharacters + 1 > bf_s1)
-      GapTo (FirstCharacter);
-  return make_string (&CharAt (FirstCharacter), NumCharacters + 1 - FirstCharacter);
+  return make_buffer_string (FirstCharacter, NumCharacters + 1);
 }
 
 DEFUN ("insert-buffer-substring", Finsert_buffer_substring, Sinsert_buffer_substring,
@@ -651,9 +782,20 @@ Lisp_Object
 save_restriction_save ()
 {
   Lisp_Object ml, mh;
+  register struct saved_position *rec;
+
   /* Note: I tried using markers here, but it does not win
      because insertion at the end of the saved region
      does not advance mh and is considered "outside" the saved region. */
+  rec = new_saved_position ();
+  if (rec)
+    {
+      rec->buffer = Fcurrent_buffer ();
+      rec->head_clip = bf_head_clip;
+      rec->tail_clip = bf_tail_clip;
+      return make_number (rec - saved_positions);
+    }
+
   XFASTINT (ml) = bf_head_clip;
   XFASTINT (mh) = bf_tail_clip;
 
@@ -666,13 +808,27 @@ save_restriction_restore (data)
 {
   register struct buffer *old = bf_cur;
   register int newhead, newtail;
+  register struct saved_position *rec;
+  Lisp_Object buffer;
 
-  Fset_buffer (XCONS (data)->car);
+  if (XTYPE (data) == Lisp_Int)
+    {
+      rec = &saved_positions[XFASTINT (data)];
+      buffer = rec->buffer;
+      newhead = rec->head_clip;
+      newtail = rec->tail_clip;
+      release_saved_positions (XFASTINT (data));
+      Fset_buffer (buffer);
+    }
+  else
+    {
+      Fset_buffer (XCONS (data)->car);
 
-  data = XCONS (data)->cdr;
+      data = XCONS (data)->cdr;
 
-  newhead = XINT (XCONS (data)->car);
-  newtail = XINT (XCONS (data)->cdr);
+      newhead = XINT (XCONS (data)->car);
+      newtail = XINT (XCONS (data)->cdr);
+    }
   if (newhead + newtail > bf_s1 + bf_s2 + 1)
     {
       newhead = 1;
@@ -747,50 +903,165 @@ the argument used by %d, %b, %o, %x or %c must be a number.")
      int nargs;
      register Lisp_Object *args;
 {
-  register int i;
-  register int total = 5;
-  char *buf;
-  register unsigned char **strings = (unsigned char **) alloca (nargs * sizeof (char *));
+  /* Each piece of the output is either literal text from the control
+     string or the text of one conversion, preceded by PAD spaces.  */
+  struct format_piece
+    {
+      unsigned char *text;
+      int len;
+      int pad;
+    };
+  register struct format_piece *piece;
+  struct format_piece *pieces;
+  register unsigned char *fmt, *end;
+  unsigned char *lit, *spec;
+  register int n;
+  register Lisp_Object arg;
+  Lisp_Object val;
+  int cnt, total, minlen, op;
+  char fmtcpy[20];
 
-  for (i = 0; i < nargs; i++)
+  if (XTYPE (args[0]) == Lisp_Symbol)
+    XSET (args[0], Lisp_String, XSYMBOL (args[0])->name);
+  CHECK_STRING (args[0], 0);
+
+  /* Check the numeric arguments before taking any pointer into string
+     data.  wrong_type_argument can enter the debugger, and a garbage
+     collection there could move the strings.  */
+  for (n = 0, cnt = 1; n < XSTRING (args[0])->size; n++)
     {
-      if (XTYPE (args[i]) == Lisp_Symbol)
-	{
-	  strings[i] = XSYMBOL (args[i])->name->data;
-	  total += XSYMBOL (args[i])->name->size;
-	}
-      else if (XTYPE (args[i]) == Lisp_String)
+      if (XSTRING (args[0])->data[n] != '%')
+	continue;
+      for (n++; n < XSTRING (args[0])->size; n++)
 	{
-	  strings[i] = XSTRING (args[i])->data;
-	  total += XSTRING (args[i])->size;
+	  op = XSTRING (args[0])->data[n];
+	  if (!((op >= '0' && op <= '9')
+		|| op == '-' || op == ' '))
+	    break;
 	}
-      else if (XTYPE (args[i]) == Lisp_Int)
+      if (n == XSTRING (args[0])->size || op == '%' || cnt >= nargs)
+	continue;
+      if (op == 'b' || op == 'd' || op == 'o' || op == 'x'
+	  || op == 'c')
+	CHECK_NUMBER (args[cnt], cnt);
+      cnt++;
+    }
+
+  fmt = XSTRING (args[0])->data;
+  end = fmt + XSTRING (args[0])->size;
+
+  /* The control string is parsed once, yielding at most two pieces
+     per conversion plus the trailing text, so that the exact length
+     of the result is known before it is allocated.  */
+  for (n = 1; fmt != end; fmt++)
+    if (*fmt == '%')
+      n += 2;
+  piece = pieces = (struct format_piece *) alloca (n * sizeof *pieces);
+
+  total = 0;
+  cnt = 1;
+  fmt = lit = XSTRING (args[0])->data;
+  while (fmt != end)
+    {
+      if (*fmt++ != '%')
+	continue;
+
+      /* Finish the literal text before this %-spec,
+	 and copy the spec into fmtcpy for sprintf.  */
+      piece->text = lit;
+      piece->len = fmt - 1 - lit;
+      piece->pad = 0;
+      total += piece++->len;
+      spec = fmt;
+      while (fmt != end
+	     && ((*fmt >= '0' && *fmt <= '9') || *fmt == '-' || *fmt == ' '))
+	fmt++;
+      if (fmt == end)
+	error ("Format string ends in middle of format specifier");
+      if (fmt - spec > sizeof fmtcpy - 3)
+	error ("Format specifier too long");
+      fmtcpy[0] = '%';
+      bcopy (spec, fmtcpy + 1, fmt - spec + 1);
+      fmtcpy[fmt - spec + 2] = 0;
+      lit = fmt + 1;
+
+      if (*fmt == '%')
 	{
-	  strings[i] = (unsigned char *) XINT (args[i]);
-	  total += 10;
+	  /* Output the % as the start of the next literal.  */
+	  lit = fmt++;
+	  continue;
 	}
-      else
+      if (cnt >= nargs)
+	error ("Not enough arguments for format string");
+      arg = args[cnt++];
+      minlen = 0;
+
+      switch (*fmt++)
 	{
-	  strings[i] = (unsigned char *) "??";
-	  total += 2;
+	default:
+	  error ("Invalid format operation %%%c", fmt[-1]);
+
+	case 'b':
+	case 'd':
+	case 'o':
+	case 'x':
+	  n = atoi (&fmtcpy[1]);
+	  n = (n < 0 ? -n : n) + 40;
+	  piece->text = (unsigned char *) alloca (n);
+	  sprintf (piece->text, fmtcpy, XINT (arg));
+	  piece->len = strlen (piece->text);
+	  break;
+
+	case 's':
+	  if (XTYPE (arg) == Lisp_Symbol)
+	    XSET (arg, Lisp_String, XSYMBOL (arg)->name);
+	  if (XTYPE (arg) == Lisp_String)
+	    {
+	      piece->text = XSTRING (arg)->data;
+	      piece->len = XSTRING (arg)->size;
+	    }
+	  else if (XTYPE (arg) == Lisp_Int)
+	    {
+	      piece->text = (unsigned char *) alloca (20);
+	      sprintf (piece->text, "%d", XINT (arg));
+	      piece->len = strlen (piece->text);
+	    }
+	  else
+	    {
+	      piece->text = (unsigned char *) "??";
+	      piece->len = 2;
+	    }
+	  if (fmtcpy[1] != 's')
+	    minlen = atoi (&fmtcpy[1]);
+	  break;
+
+	case 'c':
+	  piece->text = (unsigned char *) alloca (1);
+	  *piece->text = XINT (arg);
+	  piece->len = 1;
+	  break;
 	}
+      piece->pad = minlen > piece->len ? minlen - piece->len : 0;
+      total += piece->pad + piece->len;
+      piece++;
     }
-
-  /* Format it in bigger and bigger buf's until it all fits. */
-
-  while (1)
+  piece->text = lit;
+  piece->len = end - lit;
+  piece->pad = 0;
+  total += piece++->len;
+
+  /* Allocating the result cannot relocate the argument strings,
+     so the pieces still point at their text.  */
+  val = make_uninit_string (total);
+  fmt = XSTRING (val)->data;
+  for (n = piece - pieces, piece = pieces; n > 0; n--, piece++)
     {
-      buf = (char *) alloca (total + 1);
-      buf[total - 1] = 0;
-
-      doprnt (buf, total + 1, strings[0], strings + 1);
-      if (buf[total - 1] == 0)
-	break;
-
-      total *= 2;
+      for (minlen = piece->pad; minlen > 0; minlen--)
+	*fmt++ = ' ';
+      bcopy (piece->text, fmt, piece->len);
+      fmt += piece->len;
     }
-
-  return build_string (buf);
+  return val;
 }
 
 /* VARARGS 1 */
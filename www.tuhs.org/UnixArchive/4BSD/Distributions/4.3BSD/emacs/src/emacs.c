@@ -139,6 +139,7 @@ main (argc, argv, envp)
      char **argv;
      char **envp;
 {
+  char stack_bottom_variable;
   int skip_args = 0;
   extern int errno;
   clearerr (stdin);
@@ -208,6 +209,7 @@ main (argc, argv, envp)
 
   init_alloc ();
   init_eval ();
+  init_thread (&stack_bottom_variable); /* All threads' stacks lie beyond it */
   init_data ();
   init_read ();
 
@@ -269,6 +271,7 @@ main (argc, argv, envp)
 #endif /* subprocesses */
       syms_of_search ();
       syms_of_syntax ();
+      syms_of_thread ();
       syms_of_undo ();
       syms_of_window ();
       syms_of_xdisp ();
@@ -29,6 +29,15 @@ and this notice must be preserved on all copies.  */
 #endif
 
 #include <setjmp.h>
+#include <signal.h>
+
+#ifdef HAVE_TIMEVAL
+#ifdef HPUX
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
+#endif
 
 /* This definition is duplicated in alloc.c and keyboard.c */
 /* Putting it in lisp.h makes cc bomb out! */
@@ -864,6 +873,9 @@ If BODYFORM exits nonlocally, the UNWINDFORMS are executed anyway.")
   int count = specpdl_ptr - specpdl;
   struct gcpro gcpro1;
 
+  if (NULL (Fcdr (args)))
+    return Feval (Fcar (args));
+
   record_unwind_protect (0, Fcdr (args));
   (specpdl_ptr - 1)->symbol = Qnil;
   val = Feval (Fcar (args));
@@ -891,7 +903,19 @@ See SIGNAL for more info.")
   (args)
      Lisp_Object args;
 {
-  register Lisp_Object val;
+  return internal_lisp_condition_case (Fcar (args), Fcar (Fcdr (args)),
+				       Fcdr (Fcdr (args)));
+}
+
+/* The body of condition-case, also used by the byte-code interpreter,
+   which has VAR, BODYFORM and HANDLERS separately on its stack and
+   need not cons up an argument list.  */
+
+Lisp_Object
+internal_lisp_condition_case (var, bodyform, handlers)
+     Lisp_Object var, bodyform, handlers;
+{
+  Lisp_Object val;
   int count = specpdl_ptr - specpdl;
   struct gcpro *gcpro = gcprolist;
   struct gcpro gcpro1, gcpro2;
@@ -899,8 +923,7 @@ See SIGNAL for more info.")
   struct handler h;
   register Lisp_Object tem;
 
-  tem = Fcar (args);
-  CHECK_SYMBOL (tem, 0);
+  CHECK_SYMBOL (var, 0);
 
   c.tag = Qnil;
   c.val = Qnil;
@@ -924,8 +947,8 @@ See SIGNAL for more info.")
     }
   c.next = catchlist;
   catchlist = &c;
-  h.var = Fcar (args);
-  h.handler = Fcdr (Fcdr (args));
+  h.var = var;
+  h.handler = handlers;
   
   for (val = h.handler; NULL (val); val = Fcdr (val))
     {
@@ -939,7 +962,7 @@ See SIGNAL for more info.")
   h.tag = &c;
   handlerlist = &h;
 
-  val = Feval (Fcar (Fcdr (args)));
+  val = Feval (bodyform);
   catchlist = c.next;
   handlerlist = h.next;
   return val;
@@ -1269,6 +1292,12 @@ DEFUN ("eval", Feval, Seval, 1, 1, 0,
       Fgarbage_collect ();
       UNGCPRO;
     }
+  if (thread_countdown && !--thread_countdown)
+    {
+      GCPRO1 (form);
+      thread_preempt ();
+      UNGCPRO;
+    }
 
   if (++lisp_eval_depth > max_lisp_eval_depth)
     {
@@ -1645,6 +1674,13 @@ Thus,  (funcall 'cons 'x 'y)  returns  (x . y).")
       Fgarbage_collect ();
       UNGCPRO;
     }
+  if (thread_countdown && !--thread_countdown)
+    {
+      GCPRO1 (*args);
+      gcpro1.nvars = nargs;
+      thread_preempt ();
+      UNGCPRO;
+    }
 
   if (++lisp_eval_depth > max_lisp_eval_depth)
     {
@@ -2034,6 +2070,317 @@ Output stream used is value of standard-output.")
   return Qnil;
 }
 
+/* Sampling profiler.
+
+   While profiling is on, a SIGPROF timer interrupts Emacs every
+   profiler_interval milliseconds of CPU time.  Each interrupt copies
+   the function slots of the innermost PROFILER_DEPTH frames of
+   backtrace_list into the next free sample of profiler_log.
+   Primitives called through eval or funcall have their own frame,
+   so the first slot of a sample is the function actually running.
+
+   The log is an ordinary Lisp vector, protected by staticpro, so
+   the functions it records stay alive until the next profiler-start.
+   The handler never allocates; when the log is full, further samples
+   are only counted.  Samples that land in the middle of a garbage
+   collection are counted separately, since the log may not be
+   touched then.  */
+
+#define PROFILER_DEPTH 16
+
+/* Vector of profiler_log_size * PROFILER_DEPTH slots, or nil.  */
+Lisp_Object profiler_log;
+
+/* Number of samples the log holds; copied from the user variable
+   profiler-log-size when profiling starts.  */
+int profiler_log_size;
+int profiler_log_size_default;
+
+/* Samples recorded in the log, samples taken during GC
+   and samples dropped because the log was full.  */
+int profiler_samples;
+int profiler_gc_samples;
+int profiler_dropped_samples;
+
+/* Nonzero while the timer is running.  */
+int profiler_running;
+
+Lisp_Object Qprofiler_gc;
+
+Lisp_Object Fprofiler_stop ();
+
+#ifdef ITIMER_PROF
+
+profiler_sample (signo)
+     int signo;
+{
+  extern int gc_in_progress;
+  register struct backtrace *backlist;
+  register Lisp_Object *slot;
+  register int i;
+
+#ifdef USG
+  /* USG systems forget handlers when they are used;
+     must reestablish each time */
+  signal (signo, profiler_sample);
+#endif /* USG */
+
+  if (gc_in_progress)
+    profiler_gc_samples++;
+  else if (profiler_samples >= profiler_log_size)
+    profiler_dropped_samples++;
+  else
+    {
+      slot = XVECTOR (profiler_log)->contents
+	+ profiler_samples * PROFILER_DEPTH;
+      backlist = backtrace_list;
+      for (i = 0; i < PROFILER_DEPTH; i++)
+	{
+	  if (backlist)
+	    {
+	      slot[i] = *backlist->function;
+	      backlist = backlist->next;
+	    }
+	  else
+	    slot[i] = Qnil;
+	}
+      profiler_samples++;
+    }
+}
+
+static
+set_profiler_timer (msec)
+     int msec;
+{
+  struct itimerval it;
+
+  it.it_interval.tv_sec = msec / 1000;
+  it.it_interval.tv_usec = (msec % 1000) * 1000;
+  it.it_value = it.it_interval;
+  setitimer (ITIMER_PROF, &it, 0);
+}
+
+#endif /* ITIMER_PROF */
+
+DEFUN ("profiler-start", Fprofiler_start, Sprofiler_start, 0, 1, 0,
+  "Start the sampling profiler, discarding any previous samples.\n\
+Every INTERVAL milliseconds of CPU time (default 10) the stack of\n\
+active Lisp functions is recorded, up to profiler-log-size samples.\n\
+Use  profiler-stop  to stop sampling and  profiler-report  to see the results.")
+  (interval)
+     Lisp_Object interval;
+{
+#ifdef ITIMER_PROF
+  int msec = 10;
+
+  if (!NULL (interval))
+    {
+      CHECK_NUMBER (interval, 0);
+      msec = XINT (interval);
+      if (msec <= 0)
+	error ("Profiler interval must be positive");
+    }
+
+  if (profiler_running)
+    Fprofiler_stop ();
+
+  if (profiler_log_size_default <= 0)
+    profiler_log_size_default = 1;
+  if (NULL (profiler_log) || profiler_log_size != profiler_log_size_default)
+    {
+      /* Drop the old log first, so a GC triggered by the new
+	 allocation can reclaim it.  */
+      profiler_log = Qnil;
+      profiler_log_size = 0;
+      profiler_log = Fmake_vector (make_number (profiler_log_size_default
+						* PROFILER_DEPTH),
+				   Qnil);
+      profiler_log_size = profiler_log_size_default;
+    }
+  profiler_samples = 0;
+  profiler_gc_samples = 0;
+  profiler_dropped_samples = 0;
+
+  signal (SIGPROF, profiler_sample);
+  set_profiler_timer (msec);
+  profiler_running = 1;
+  return Qt;
+#else /* not ITIMER_PROF */
+  error ("Profiling is not supported on this system");
+#endif /* not ITIMER_PROF */
+}
+
+DEFUN ("profiler-stop", Fprofiler_stop, Sprofiler_stop, 0, 0, 0,
+  "Stop the sampling profiler.  The samples taken so far are kept\n\
+for  profiler-report.  Returns the number of samples taken.")
+  ()
+{
+  Lisp_Object val;
+
+#ifdef ITIMER_PROF
+  if (profiler_running)
+    {
+      set_profiler_timer (0);
+      signal (SIGPROF, SIG_IGN);
+      profiler_running = 0;
+    }
+#endif /* ITIMER_PROF */
+  XFASTINT (val) = profiler_samples + profiler_gc_samples
+    + profiler_dropped_samples;
+  return val;
+}
+
+/* A node of the call tree built by profiler-report is a vector
+   [FUNCTION TOTAL SELF CHILDREN], where TOTAL counts the samples
+   in which FUNCTION was active below the node's caller, SELF those
+   in which it was the innermost frame, and CHILDREN is a list of
+   nodes for the functions it called.  */
+
+static Lisp_Object
+profiler_child (node, fn)
+     Lisp_Object node, fn;
+{
+  register Lisp_Object tail, child;
+
+  for (tail = XVECTOR (node)->contents[3]; !NULL (tail);
+       tail = XCONS (tail)->cdr)
+    if (EQ (XVECTOR (XCONS (tail)->car)->contents[0], fn))
+      return XCONS (tail)->car;
+
+  child = Fmake_vector (make_number (4), Qnil);
+  XVECTOR (child)->contents[0] = fn;
+  XFASTINT (XVECTOR (child)->contents[1]) = 0;
+  XFASTINT (XVECTOR (child)->contents[2]) = 0;
+  XVECTOR (node)->contents[3] = Fcons (child, XVECTOR (node)->contents[3]);
+  return child;
+}
+
+/* Return the list of nodes LIST sorted by decreasing total count.  */
+
+static Lisp_Object
+profiler_sort (list)
+     Lisp_Object list;
+{
+  Lisp_Object sorted, next;
+  register Lisp_Object *prev;
+  register int total;
+
+  sorted = Qnil;
+  while (!NULL (list))
+    {
+      next = XCONS (list)->cdr;
+      total = XFASTINT (XVECTOR (XCONS (list)->car)->contents[1]);
+      prev = &sorted;
+      while (!NULL (*prev)
+	     && XFASTINT (XVECTOR (XCONS (*prev)->car)->contents[1]) >= total)
+	prev = &XCONS (*prev)->cdr;
+      XCONS (list)->cdr = *prev;
+      *prev = list;
+      list = next;
+    }
+  return sorted;
+}
+
+static
+profiler_print_percent (count, total)
+     int count, total;
+{
+  char buf[20];
+
+  sprintf (buf, "%5d.%d%%", count * 100 / total,
+	   (count * 1000 / total) % 10);
+  write_string (buf, -1);
+}
+
+static
+profiler_print_tree (list, depth, total)
+     Lisp_Object list;
+     int depth, total;
+{
+  register Lisp_Object node, fn;
+  register int i;
+
+  for (list = profiler_sort (list); !NULL (list); list = XCONS (list)->cdr)
+    {
+      node = XCONS (list)->car;
+      fn = XVECTOR (node)->contents[0];
+      profiler_print_percent (XFASTINT (XVECTOR (node)->contents[1]), total);
+      profiler_print_percent (XFASTINT (XVECTOR (node)->contents[2]), total);
+      write_string ("  ", 2);
+      for (i = 0; i < depth; i++)
+	write_string ("  ", 2);
+      if (XTYPE (fn) == Lisp_Cons && EQ (XCONS (fn)->car, Qlambda))
+	write_string ("(lambda ...)", -1);
+      else
+	Fprin1 (fn, Qnil);
+      write_string ("\n", 1);
+      profiler_print_tree (XVECTOR (node)->contents[3], depth + 1, total);
+    }
+}
+
+static Lisp_Object
+profiler_report_1 (root)
+     Lisp_Object root;
+{
+  char buf[100];
+  int total = XFASTINT (XVECTOR (root)->contents[1]);
+
+  sprintf (buf, "%d samples, %d during garbage collection, %d dropped.\n\n",
+	   total, profiler_gc_samples, profiler_dropped_samples);
+  write_string (buf, -1);
+  if (total == 0)
+    return Qnil;
+  write_string ("  Total    Self  Function\n", -1);
+  profiler_print_tree (XVECTOR (root)->contents[3], 0, total);
+  return Qnil;
+}
+
+DEFUN ("profiler-report", Fprofiler_report, Sprofiler_report, 0, 0, "",
+  "Display the samples taken by the profiler as a call tree.\n\
+Each line shows the percentage of samples in which a function was\n\
+active when called from the function on the line above it (Total),\n\
+the percentage in which it was the innermost frame (Self), and its name.\n\
+Samples taken while garbage collecting are shown as  profiler-gc.")
+  ()
+{
+  Lisp_Object root, node;
+  register Lisp_Object *sample;
+  register int i, depth;
+  int nsamples = profiler_samples;
+  struct gcpro gcpro1;
+
+  root = Fmake_vector (make_number (4), Qnil);
+  XFASTINT (XVECTOR (root)->contents[1]) = 0;
+  GCPRO1 (root);
+
+  for (i = 0; i < nsamples; i++)
+    {
+      sample = XVECTOR (profiler_log)->contents + i * PROFILER_DEPTH;
+      for (depth = PROFILER_DEPTH; depth > 0 && NULL (sample[depth - 1]);
+	   depth--);
+      node = root;
+      XFASTINT (XVECTOR (node)->contents[1])++;
+      while (depth > 0)
+	{
+	  node = profiler_child (node, sample[--depth]);
+	  XFASTINT (XVECTOR (node)->contents[1])++;
+	}
+      XFASTINT (XVECTOR (node)->contents[2])++;
+    }
+
+  if (profiler_gc_samples)
+    {
+      node = profiler_child (root, Qprofiler_gc);
+      XFASTINT (XVECTOR (node)->contents[1]) += profiler_gc_samples;
+      XFASTINT (XVECTOR (node)->contents[2]) += profiler_gc_samples;
+      XFASTINT (XVECTOR (root)->contents[1]) += profiler_gc_samples;
+    }
+
+  internal_with_output_to_temp_buffer ("*Profile*", profiler_report_1, root);
+  UNGCPRO;
+  return Qnil;
+}
+
 syms_of_eval ()
 {
   DefIntVar ("max-specpdl-size", &max_specpdl_size,
@@ -2150,4 +2497,17 @@ If due to eval entry, one arg, 't.");
   defsubr (&Sfuncall);
   defsubr (&Sbacktrace_debug);
   defsubr (&Sbacktrace);
+
+  staticpro (&profiler_log);
+  profiler_log = Qnil;
+  Qprofiler_gc = intern ("profiler-gc");
+  staticpro (&Qprofiler_gc);
+  DefIntVar ("profiler-log-size", &profiler_log_size_default,
+    "Number of samples the profiler records before it starts dropping them.\n\
+Takes effect at the next  profiler-start.");
+  profiler_log_size_default = 1000;
+
+  defsubr (&Sprofiler_start);
+  defsubr (&Sprofiler_stop);
+  defsubr (&Sprofiler_report);
 }
@@ -43,6 +43,9 @@ int insert_default_directory;
 
 Lisp_Object Qfile_error, Qfile_already_exists;
 
+/* Set when a file is created, so that load rechecks its directory index.  */
+extern int load_path_index_stale;
+
 report_file_error (string, data)
      char *string;
      Lisp_Object data;
@@ -481,6 +484,7 @@ unless a third argument OK-IF-ALREADY-EXISTS is supplied and non-nil.")
 
   close (ifd);
   close (ofd);
+  load_path_index_stale = 1;
   return Qnil;
 }
 
@@ -540,6 +544,7 @@ unless optional third argument OK-IF-ALREADY-EXISTS is non-nil.")
 	report_file_error ("Renaming", Flist (2, &filename));
 #endif
     }
+  load_path_index_stale = 1;
   return Qnil;
 }
 
@@ -902,6 +907,7 @@ If VISIT is neither t nor nil, it means do not print\n\
 
   fstat (fd, &st);
   close (fd);
+  load_path_index_stale = 1;
   /* Discard the unwind protect */
   specpdl_ptr = specpdl + count;
 
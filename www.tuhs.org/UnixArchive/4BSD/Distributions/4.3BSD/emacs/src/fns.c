@@ -295,7 +295,7 @@ concat (nargs, args, target_type, last_special)
   else if (target_type == Lisp_Vector)
     val = Fmake_vector (len, Qnil);
   else
-    val = Fmake_string (len, len);
+    val = make_uninit_string (leni);
 
   /* In append, if all but last arg are nil, return last arg */
   if (target_type == Lisp_Cons && EQ (val, Qnil))
@@ -385,7 +385,7 @@ If FROM or TO is negative, it counts from the end.")
     args_out_of_range_3 (string, from, to);
 
   XFASTINT (len) = XINT (to) - XINT (from);
-  val = Fmake_string (len, len);
+  val = make_uninit_string (XINT (len));
 
   bcopy (XSTRING (string)->data + XINT (from), XSTRING (val)->data, XINT (len));
 
@@ -588,99 +588,292 @@ DEFUN ("reverse", Freverse, Sreverse, 1, 1, 0,
   return Flist (XINT (length), vector);
 }
 
-Lisp_Object merge ();
+/* Sorting.
+
+   The elements are sorted in a vector by a stable natural merge sort,
+   as in timsort without galloping: runs already in order are found
+   (and reversed, if strictly descending), runs shorter than
+   SORT_MIN_RUN are extended by binary insertion, and pending runs
+   are merged so that their lengths grow at least like Fibonacci
+   numbers, which keeps the stack of runs short.
+
+   When the predicate is < or string-lessp, it is called directly
+   in C, and integers or strings are compared without calling it.
+
+   The predicate may cause garbage collection, which relocates
+   strings, so elements are always refetched from a Lisp vector
+   after calling it.  */
+
+#define SORT_MIN_RUN 32
+#define SORT_MAX_RUNS 64
+
+struct sort_info
+  {
+    Lisp_Object pred;
+    Lisp_Object (*subr) ();	/* Flss or Fstring_lessp, or 0 */
+    Lisp_Object *tmp;		/* Contents of a scratch vector */
+  };
+
+static int
+sort_lessp (info, a, b)
+     register struct sort_info *info;
+     Lisp_Object a, b;
+{
+  register unsigned char *p1, *p2;
+  register int end, i;
 
-DEFUN ("sort", Fsort, Ssort, 2, 2, 0,
-  "Sort LIST, stably, comparing elements using PREDICATE.\n\
-Returns the sorted list.  LIST is modified by side effects.\n\
-PREDICATE is called with two elements of LIST, and should return T\n\
-if the first element is \"less\" than the second.")
-  (list, pred)
-     Lisp_Object list, pred;
+  if (info->subr == Flss)
+    {
+      if (XTYPE (a) == Lisp_Int && XTYPE (b) == Lisp_Int)
+	return XINT (a) < XINT (b);
+      return !NULL (Flss (a, b));
+    }
+  if (info->subr == Fstring_lessp)
+    {
+      if (XTYPE (a) != Lisp_String || XTYPE (b) != Lisp_String)
+	return !NULL (Fstring_lessp (a, b));
+      p1 = XSTRING (a)->data;
+      p2 = XSTRING (b)->data;
+      end = XSTRING (a)->size;
+      if (end > XSTRING (b)->size)
+	end = XSTRING (b)->size;
+      for (i = 0; i < end; i++)
+	if (p1[i] != p2[i])
+	  return p1[i] < p2[i];
+      return i < XSTRING (b)->size;
+    }
+  return !NULL (call2 (info->pred, a, b));
+}
+
+/* Return the length of the run starting at V[LO], at most HI - LO,
+   making it ascending if it was strictly descending.  */
+
+static int
+sort_count_run (info, v, lo, hi)
+     struct sort_info *info;
+     register Lisp_Object *v;
+     int lo, hi;
 {
-  Lisp_Object front, back;
-  register Lisp_Object len, tem;
-  struct gcpro gcpro1, gcpro2;
-  register int length;
+  register int i = lo + 1, j, k;
+  Lisp_Object tem;
 
-  front = list;
-  len = Flength (list);
-  length = XINT (len);
-  if (length < 2)
-    return list;
+  if (i == hi)
+    return 1;
+  if (sort_lessp (info, v[i], v[lo]))
+    {
+      while (i + 1 < hi && sort_lessp (info, v[i + 1], v[i]))
+	i++;
+      for (j = lo, k = i; j < k; j++, k--)
+	tem = v[j], v[j] = v[k], v[k] = tem;
+      return i + 1 - lo;
+    }
+  while (i + 1 < hi && !sort_lessp (info, v[i + 1], v[i]))
+    i++;
+  return i + 1 - lo;
+}
+
+/* Sort V[LO] through V[HI - 1] by binary insertion,
+   given that V[LO] through V[START - 1] are already sorted.  */
 
-  XSETINT (len, (length / 2) - 1);
-  tem = Fnthcdr (len, list);
-  back = Fcdr (tem);
-  Fsetcdr (tem, Qnil);
+static
+sort_insertion (info, v, lo, hi, start)
+     struct sort_info *info;
+     register Lisp_Object *v;
+     int lo, hi, start;
+{
+  register int l, r, m;
+  Lisp_Object pivot;
+  struct gcpro gcpro1;
 
-  GCPRO2 (front, back);
-  front = Fsort (front, pred);
-  back = Fsort (back, pred);
+  pivot = Qnil;
+  GCPRO1 (pivot);
+  for (; start < hi; start++)
+    {
+      pivot = v[start];
+      /* Find where it goes, after any elements equal to it.  */
+      for (l = lo, r = start; l < r; )
+	{
+	  m = (l + r) / 2;
+	  if (sort_lessp (info, pivot, v[m]))
+	    r = m;
+	  else
+	    l = m + 1;
+	}
+      for (m = start; m > l; m--)
+	v[m] = v[m - 1];
+      v[l] = pivot;
+    }
   UNGCPRO;
-  return merge (front, back, pred);
 }
 
-Lisp_Object
-merge (org_l1, org_l2, pred)
-     Lisp_Object org_l1, org_l2;
-     Lisp_Object pred;
+/* Merge the adjacent sorted runs V[LO..MID-1] and V[MID..HI-1],
+   copying the shorter one to the scratch vector.  */
+
+static
+sort_merge (info, v, lo, mid, hi)
+     register struct sort_info *info;
+     register Lisp_Object *v;
+     int lo, mid, hi;
 {
-  Lisp_Object value;
-  register Lisp_Object tail;
-  Lisp_Object tem;
-  register Lisp_Object l1, l2;
-  struct gcpro gcpro1, gcpro2, gcpro3, gcpro4;
+  register Lisp_Object *tmp = info->tmp;
+  register int i, j, k, n;
 
-  l1 = org_l1;
-  l2 = org_l2;
-  tail = Qnil;
-  value = Qnil;
+  /* Elements of the left run not greater than the right run's
+     first element are already in place.  */
+  for (i = lo, j = mid; i < j; )
+    {
+      k = (i + j) / 2;
+      if (sort_lessp (info, v[mid], v[k]))
+	j = k;
+      else
+	i = k + 1;
+    }
+  lo = i;
+  if (lo == mid)
+    return;
 
-  /* It is sufficient to protect org_l1 and org_l2.
-     When l1 and l2 are updated, we copy the new values
-     back into the org_ vars.  */
-  GCPRO4 (org_l1, org_l2, pred, value);
+  if (mid - lo <= hi - mid)
+    {
+      /* Merge forward from a copy of the left run.  */
+      n = mid - lo;
+      bcopy (v + lo, tmp, n * sizeof (Lisp_Object));
+      for (i = 0, j = mid, k = lo; i < n && j < hi; k++)
+	if (sort_lessp (info, v[j], tmp[i]))
+	  v[k] = v[j++];
+	else
+	  v[k] = tmp[i++];
+      while (i < n)
+	v[k++] = tmp[i++];
+    }
+  else
+    {
+      /* Merge backward from a copy of the right run.  */
+      n = hi - mid;
+      bcopy (v + mid, tmp, n * sizeof (Lisp_Object));
+      for (i = mid - 1, j = n - 1, k = hi - 1; i >= lo && j >= 0; k--)
+	if (sort_lessp (info, tmp[j], v[i]))
+	  v[k] = v[i--];
+	else
+	  v[k] = tmp[j--];
+      while (j >= 0)
+	v[k--] = tmp[j--];
+    }
+}
 
-  while (1)
+/* Sort the N elements of V.  */
+
+static
+sort_vector (info, v, n)
+     register struct sort_info *info;
+     register Lisp_Object *v;
+     int n;
+{
+  int base[SORT_MAX_RUNS], len[SORT_MAX_RUNS];
+  register int nruns = 0, lo = 0, runlen, k;
+
+  while (lo < n)
     {
-      if (NULL (l1))
+      runlen = sort_count_run (info, v, lo, n);
+      if (runlen < SORT_MIN_RUN)
 	{
-	  UNGCPRO;
-	  if (NULL (tail))
-	    return l2;
-	  Fsetcdr (tail, l2);
-	  return value;
+	  k = n - lo < SORT_MIN_RUN ? n - lo : SORT_MIN_RUN;
+	  sort_insertion (info, v, lo, lo + k, lo + runlen);
+	  runlen = k;
 	}
-      if (NULL (l2))
-	{
-	  UNGCPRO;
-	  if (NULL (tail))
-	    return l1;
-	  Fsetcdr (tail, l1);
-	  return value;
-	}
-      tem = call2 (pred, Fcar (l1), Fcar (l2));
-      if (!NULL (tem))
-	{
-	  tem = l1;
-	  l1 = Fcdr (l1);
-	  org_l1 = l1;
-	}
-      else
+      base[nruns] = lo;
+      len[nruns++] = runlen;
+      lo += runlen;
+
+      /* Merge until each pending run is longer than the next two.  */
+      while (nruns > 1)
 	{
-	  tem = l2;
-	  l2 = Fcdr (l2);
-	  org_l2 = l2;
+	  k = nruns - 2;
+	  if ((k > 0 && len[k - 1] <= len[k] + len[k + 1])
+	      || (k > 1 && len[k - 2] <= len[k - 1] + len[k]))
+	    {
+	      if (len[k - 1] < len[k + 1])
+		k--;
+	    }
+	  else if (len[k] > len[k + 1])
+	    break;
+	  sort_merge (info, v, base[k], base[k + 1],
+		      base[k + 1] + len[k + 1]);
+	  len[k] += len[k + 1];
+	  for (k++; k + 1 < nruns; k++)
+	    base[k] = base[k + 1], len[k] = len[k + 1];
+	  nruns--;
 	}
-      if (NULL (tail))
-	value = tem;
-      else
-	Fsetcdr (tail, tem);
-      tail = tem;
+    }
+
+  while (nruns > 1)
+    {
+      k = nruns - 2;
+      sort_merge (info, v, base[k], base[k + 1], n);
+      len[k] += len[k + 1];
+      nruns--;
     }
 }
-
+
+DEFUN ("sort", Fsort, Ssort, 2, 2, 0,
+  "Sort SEQ, stably, comparing elements using PREDICATE.\n\
+SEQ may be a list or a vector; it is modified by side effects\n\
+and the sorted sequence is returned.\n\
+PREDICATE is called with two elements of SEQ, and should return T\n\
+if the first element is \"less\" than the second.")
+  (seq, pred)
+     Lisp_Object seq, pred;
+{
+  struct sort_info info;
+  Lisp_Object vec, tmp, fun;
+  register Lisp_Object tail;
+  register int length, i;
+  struct gcpro gcpro1, gcpro2, gcpro3, gcpro4;
+
+  while (XTYPE (seq) != Lisp_Vector && !LISTP (seq) && !NULL (seq))
+    seq = wrong_type_argument (Qlistp, seq);
+
+  /* Sort a copy of the elements, and store them back into SEQ only
+     once the sort is done.  During a merge some elements are held
+     only in TMP, so if PREDICATE exits nonlocally, SEQ must not be
+     the vector being sorted.  */
+  length = XTYPE (seq) == Lisp_Vector ? XVECTOR (seq)->size
+    : XINT (Flength (seq));
+  if (length < 2)
+    return seq;
+  vec = Fmake_vector (make_number (length), Qnil);
+  if (XTYPE (seq) == Lisp_Vector)
+    bcopy (XVECTOR (seq)->contents, XVECTOR (vec)->contents,
+	   length * sizeof (Lisp_Object));
+  else
+    for (i = 0, tail = seq; i < length; i++, tail = XCONS (tail)->cdr)
+      XVECTOR (vec)->contents[i] = XCONS (tail)->car;
+  tmp = Fmake_vector (make_number (length / 2 + 1), Qnil);
+
+  info.pred = pred;
+  info.subr = 0;
+  info.tmp = XVECTOR (tmp)->contents;
+  for (fun = pred; XTYPE (fun) == Lisp_Symbol && !NULL (fun)
+       && !EQ (fun, Qunbound); )
+    fun = XSYMBOL (fun)->function;
+  if (XTYPE (fun) == Lisp_Subr
+      && (XSUBR (fun)->function == Flss
+	  || XSUBR (fun)->function == Fstring_lessp))
+    info.subr = XSUBR (fun)->function;
+
+  GCPRO4 (seq, pred, vec, tmp);
+  sort_vector (&info, XVECTOR (vec)->contents, length);
+  UNGCPRO;
+
+  if (XTYPE (seq) == Lisp_Vector)
+    bcopy (XVECTOR (vec)->contents, XVECTOR (seq)->contents,
+	   length * sizeof (Lisp_Object));
+  else
+    for (i = 0, tail = seq; i < length && LISTP (tail);
+	 i++, tail = XCONS (tail)->cdr)
+      XCONS (tail)->car = XVECTOR (vec)->contents[i];
+  return seq;
+}
+
 DEFUN ("get", Fget, Sget, 2, 2, 0,
   "Return the value of SYMBOL's PROPNAME property.\n\
 This is the last VALUE stored with  (put SYMBOL PROPNAME VALUE).")
@@ -780,6 +973,342 @@ do_cdr:
   return Qnil;
 }
 
+/* Hash tables.  See struct Lisp_Hash_Table in lisp.h for the layout.  */
+
+Lisp_Object Qeq, Qeql, Qequal, Qhash_table_p;
+
+/* Number of entry slots a new hash table gets at least.
+   Must be a power of two.  */
+#define HASH_TABLE_MIN_SLOTS 8
+
+/* How deep into conses and vectors sxhash looks,
+   and how many elements of each it looks at.  */
+#define SXHASH_MAX_DEPTH 3
+#define SXHASH_MAX_LEN 7
+
+#define HASH_KEY(kv, i) ((kv)->contents[2 * (i)])
+#define HASH_VALUE(kv, i) ((kv)->contents[2 * (i) + 1])
+#define HASH_TABLE_SLOTS(h) (XVECTOR ((h)->key_and_value)->size / 2)
+
+/* Return a hash code for OBJ which is the same
+   for any two objects that are `equal'.  */
+
+static unsigned int
+sxhash (obj, depth)
+     Lisp_Object obj;
+     int depth;
+{
+  register unsigned int hash;
+  register int i;
+
+  if (depth > SXHASH_MAX_DEPTH)
+    return 0;
+
+#ifdef SWITCH_ENUM_BUG
+  switch ((int) XTYPE (obj))
+#else
+  switch (XTYPE (obj))
+#endif
+    {
+    case Lisp_String:
+      return hash_string (XSTRING (obj)->data, XSTRING (obj)->size);
+
+    case Lisp_Cons:
+      hash = 0;
+      for (i = 0; i < SXHASH_MAX_LEN && LISTP (obj); i++)
+	{
+	  hash = hash * 31 + sxhash (XCONS (obj)->car, depth + 1);
+	  obj = XCONS (obj)->cdr;
+	}
+      if (!LISTP (obj) && !NULL (obj))
+	hash = hash * 31 + sxhash (obj, depth + 1);
+      return hash;
+
+    case Lisp_Vector:
+      hash = XVECTOR (obj)->size;
+      for (i = 0; i < SXHASH_MAX_LEN && i < XVECTOR (obj)->size; i++)
+	hash = hash * 31 + sxhash (XVECTOR (obj)->contents[i], depth + 1);
+      return hash;
+
+    case Lisp_Marker:
+      return (int) XMARKER (obj)->buffer + XMARKER (obj)->bufpos;
+
+    default:
+      return XFASTINT (obj);
+    }
+}
+
+/* Return the hash code of KEY in hash table H.  */
+
+static unsigned int
+hash_code (h, key)
+     struct Lisp_Hash_Table *h;
+     Lisp_Object key;
+{
+  register unsigned int hash;
+
+  if (EQ (h->test, Qequal))
+    return sxhash (key, 0);
+  /* Objects are aligned, so the low bits of an address say little.
+     Mix the high bits down into them.  */
+  hash = XFASTINT (key);
+  hash ^= hash >> 11;
+  hash *= 2654435761;
+  return hash ^ (hash >> 15);
+}
+
+/* Rebuild the key_and_value of hash table H with SLOTS entry slots,
+   discarding removed entries and putting each live one
+   where its hash code now says it belongs.  */
+
+static void
+hash_rehash (h, slots)
+     register struct Lisp_Hash_Table *h;
+     int slots;
+{
+  Lisp_Object len;
+  register struct Lisp_Vector *okv, *nkv;
+  register int i, j, mask;
+  int oslots;
+
+  okv = XVECTOR (h->key_and_value);
+  oslots = okv->size / 2;
+  XFASTINT (len) = 2 * slots;
+  h->key_and_value = Fmake_vector (len, Qunbound);
+  h->rehash = Qnil;
+  nkv = XVECTOR (h->key_and_value);
+  mask = slots - 1;
+
+  for (i = 0; i < oslots; i++)
+    if (!EQ (HASH_KEY (okv, i), Qunbound))
+      {
+	for (j = hash_code (h, HASH_KEY (okv, i)) & mask;
+	     !EQ (HASH_KEY (nkv, j), Qunbound);
+	     j = (j + 1) & mask);
+	HASH_KEY (nkv, j) = HASH_KEY (okv, i);
+	HASH_VALUE (nkv, j) = HASH_VALUE (okv, i);
+      }
+  h->used = h->count;
+}
+
+/* Return the index of the entry for KEY in hash table H, or -1.  */
+
+static int
+hash_lookup (h, key)
+     register struct Lisp_Hash_Table *h;
+     Lisp_Object key;
+{
+  register struct Lisp_Vector *kv;
+  register int i, mask;
+  register Lisp_Object tem;
+  int equal = EQ (h->test, Qequal);
+
+  if (!NULL (h->rehash))
+    hash_rehash (h, HASH_TABLE_SLOTS (h));
+
+  kv = XVECTOR (h->key_and_value);
+  mask = kv->size / 2 - 1;
+  for (i = hash_code (h, key) & mask; ; i = (i + 1) & mask)
+    {
+      tem = HASH_KEY (kv, i);
+      if (EQ (tem, Qunbound))
+	{
+	  /* An empty slot ends the search; a removed entry does not.  */
+	  if (EQ (HASH_VALUE (kv, i), Qunbound))
+	    return -1;
+	}
+      else if (EQ (tem, key)
+	       || (equal && XTYPE (tem) == XTYPE (key)
+		   && !NULL (Fequal (tem, key))))
+	return i;
+    }
+}
+
+DEFUN ("make-hash-table", Fmake_hash_table, Smake_hash_table, 0, 2, 0,
+  "Return a new, empty hash table.\n\
+Optional first arg TEST says how keys are compared;\n\
+it may be  eq,  eql  or  equal,  and defaults to  eql.\n\
+Optional second arg SIZE is the number of entries to make room for;\n\
+the table grows automatically when it needs more.")
+  (test, size)
+     Lisp_Object test, size;
+{
+  Lisp_Object table, len;
+  register struct Lisp_Hash_Table *h;
+  register int slots;
+
+  if (NULL (test))
+    test = Qeql;
+  else if (!EQ (test, Qeq) && !EQ (test, Qeql) && !EQ (test, Qequal))
+    error ("Invalid hash table test");
+
+  slots = HASH_TABLE_MIN_SLOTS;
+  if (!NULL (size))
+    {
+      CHECK_NUMBER (size, 1);
+      while (slots * 3 < XINT (size) * 4)
+	slots *= 2;
+    }
+
+  table = Fmake_vector (make_number ((sizeof (struct Lisp_Hash_Table)
+				      - sizeof (int) - sizeof (struct Lisp_Vector *))
+				     / sizeof (Lisp_Object)),
+			Qnil);
+  XSETTYPE (table, Lisp_Hash_Table);
+
+  h = XHASH_TABLE (table);
+  h->test = test;
+  XFASTINT (h->count) = 0;
+  XFASTINT (h->used) = 0;
+  h->rehash = Qnil;
+  XFASTINT (len) = 2 * slots;
+  h->key_and_value = Fmake_vector (len, Qunbound);
+  return table;
+}
+
+DEFUN ("hash-table-p", Fhash_table_p, Shash_table_p, 1, 1, 0,
+  "T if OBJECT is a hash table.")
+  (obj)
+     Lisp_Object obj;
+{
+  return XTYPE (obj) == Lisp_Hash_Table ? Qt : Qnil;
+}
+
+DEFUN ("hash-table-count", Fhash_table_count, Shash_table_count, 1, 1, 0,
+  "Return the number of entries in hash TABLE.")
+  (table)
+     Lisp_Object table;
+{
+  CHECK_HASH_TABLE (table, 0);
+  return XHASH_TABLE (table)->count;
+}
+
+DEFUN ("gethash", Fgethash, Sgethash, 2, 3, 0,
+  "Return the value stored under KEY in hash TABLE.\n\
+If there is none, return DEFAULT, or nil if DEFAULT is omitted.")
+  (key, table, dflt)
+     Lisp_Object key, table, dflt;
+{
+  register int i;
+
+  CHECK_HASH_TABLE (table, 1);
+  i = hash_lookup (XHASH_TABLE (table), key);
+  if (i < 0)
+    return dflt;
+  return HASH_VALUE (XVECTOR (XHASH_TABLE (table)->key_and_value), i);
+}
+
+DEFUN ("puthash", Fputhash, Sputhash, 3, 3, 0,
+  "Store VALUE under KEY in hash TABLE, replacing any value there already.\n\
+Returns VALUE.")
+  (key, value, table)
+     Lisp_Object key, value, table;
+{
+  register struct Lisp_Hash_Table *h;
+  register struct Lisp_Vector *kv;
+  register int i, mask, slots;
+
+  CHECK_HASH_TABLE (table, 2);
+  h = XHASH_TABLE (table);
+
+  i = hash_lookup (h, key);
+  if (i >= 0)
+    {
+      HASH_VALUE (XVECTOR (h->key_and_value), i) = value;
+      return value;
+    }
+
+  /* Keep at least a quarter of the slots empty, so lookups stay short.
+     If many used slots only hold removed entries,
+     rehashing at the same size is enough to reclaim them.  */
+  slots = HASH_TABLE_SLOTS (h);
+  if ((XFASTINT (h->used) + 1) * 4 > slots * 3)
+    {
+      if ((XFASTINT (h->count) + 1) * 2 > slots)
+	slots *= 2;
+      hash_rehash (h, slots);
+    }
+
+  kv = XVECTOR (h->key_and_value);
+  mask = slots - 1;
+  for (i = hash_code (h, key) & mask;
+       !EQ (HASH_KEY (kv, i), Qunbound);
+       i = (i + 1) & mask);
+  if (EQ (HASH_VALUE (kv, i), Qunbound))
+    XFASTINT (h->used)++;
+  HASH_KEY (kv, i) = key;
+  HASH_VALUE (kv, i) = value;
+  XFASTINT (h->count)++;
+  return value;
+}
+
+DEFUN ("remhash", Fremhash, Sremhash, 2, 2, 0,
+  "Remove the entry for KEY from hash TABLE, if there is one.")
+  (key, table)
+     Lisp_Object key, table;
+{
+  register struct Lisp_Hash_Table *h;
+  register int i;
+
+  CHECK_HASH_TABLE (table, 1);
+  h = XHASH_TABLE (table);
+  i = hash_lookup (h, key);
+  if (i >= 0)
+    {
+      HASH_KEY (XVECTOR (h->key_and_value), i) = Qunbound;
+      HASH_VALUE (XVECTOR (h->key_and_value), i) = Qnil;
+      XFASTINT (h->count)--;
+    }
+  return Qnil;
+}
+
+DEFUN ("clrhash", Fclrhash, Sclrhash, 1, 1, 0,
+  "Remove all entries from hash TABLE.")
+  (table)
+     Lisp_Object table;
+{
+  register struct Lisp_Hash_Table *h;
+
+  CHECK_HASH_TABLE (table, 0);
+  h = XHASH_TABLE (table);
+  Ffillarray (h->key_and_value, Qunbound);
+  XFASTINT (h->count) = 0;
+  XFASTINT (h->used) = 0;
+  h->rehash = Qnil;
+  return table;
+}
+
+DEFUN ("maphash", Fmaphash, Smaphash, 2, 2, 0,
+  "Call FUNCTION for each entry in hash TABLE, passing the key and the value.\n\
+FUNCTION may alter TABLE; it is still called for just the entries\n\
+that TABLE had when  maphash  was called.")
+  (function, table)
+     Lisp_Object function, table;
+{
+  Lisp_Object kv;
+  register int i;
+  struct gcpro gcpro1, gcpro2;
+
+  CHECK_HASH_TABLE (table, 1);
+  kv = Fcopy_sequence (XHASH_TABLE (table)->key_and_value);
+  GCPRO2 (kv, function);
+  for (i = 0; i < XVECTOR (kv)->size; i += 2)
+    if (!EQ (XVECTOR (kv)->contents[i], Qunbound))
+      call2 (function, XVECTOR (kv)->contents[i],
+	     XVECTOR (kv)->contents[i + 1]);
+  UNGCPRO;
+  return Qnil;
+}
+
+DEFUN ("sxhash", Fsxhash, Ssxhash, 1, 1, 0,
+  "Return a hash code for OBJECT.\n\
+Objects that are  equal  have the same hash code.")
+  (obj)
+     Lisp_Object obj;
+{
+  return make_number (sxhash (obj, 0) & 037777777);
+}
+
 DEFUN ("fillarray", Ffillarray, Sfillarray, 2, 2, 0,
   "Store each element of ARRAY with ITEM.  ARRAY is a vector or string.")
   (array, item)
@@ -1225,6 +1754,14 @@ syms_of_fns ()
 {
   Qstring_lessp = intern ("string-lessp");
   staticpro (&Qstring_lessp);
+  Qeq = intern ("eq");
+  staticpro (&Qeq);
+  Qeql = intern ("eql");
+  staticpro (&Qeql);
+  Qequal = intern ("equal");
+  staticpro (&Qequal);
+  Qhash_table_p = intern ("hash-table-p");
+  staticpro (&Qhash_table_p);
 
   DefLispVar ("features", &Vfeatures,
     "A list of symbols which are the features of the executing emacs.\n\
@@ -1257,6 +1794,15 @@ Used by  featurep  and  require, and altered by  provide.");
   defsubr (&Sget);
   defsubr (&Sput);
   defsubr (&Sequal);
+  defsubr (&Smake_hash_table);
+  defsubr (&Shash_table_p);
+  defsubr (&Shash_table_count);
+  defsubr (&Sgethash);
+  defsubr (&Sputhash);
+  defsubr (&Sremhash);
+  defsubr (&Sclrhash);
+  defsubr (&Smaphash);
+  defsubr (&Ssxhash);
   defsubr (&Sfillarray);
   defsubr (&Snconc);
   defsubr (&Smapcar);
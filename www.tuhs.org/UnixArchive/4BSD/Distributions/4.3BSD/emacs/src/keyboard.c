@@ -23,6 +23,14 @@ and this notice must be preserved on all copies.  */
 
 #include "config.h"
 #include <stdio.h>
+
+#ifdef HAVE_TIMEVAL
+#ifdef HPUX
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
+#endif
 #undef NULL
 #include "termchar.h"
 #include "termopts.h"
@@ -802,6 +810,10 @@ kbd_buffer_get_char ()
 {
   register int c;
   int nread;
+  int wait;
+
+  if (in_background_thread ())
+    error ("A background thread cannot read the keyboard");
 
   if (noninteractive)
     {
@@ -822,11 +834,30 @@ kbd_buffer_get_char ()
 #endif /* SIGIO */
       if (!kbd_count)
 	{
+	  /* Let background threads run until input arrives.
+	     Then wait only as long as none of them can go on.  */
+	  wait = run_threads ();
 #ifdef subprocesses
-	  wait_reading_process_input (0, -1, 1);
+	  wait_reading_process_input (wait, -1, 1);
 #else
+	  if (wait > 0)
+	    {
+	      /* Sleep until there is input or a thread wakes up.  */
+#ifdef HAVE_TIMEVAL
+	      struct timeval timeout;
+#endif
+	      int waitchannels = 1;
+
+#ifdef HAVE_TIMEVAL
+	      timeout.tv_sec = wait;
+	      timeout.tv_usec = 0;
+	      select (1, &waitchannels, 0, 0, &timeout);
+#else
+	      select (1, &waitchannels, 0, 0, &wait);
+#endif
+	    }
 #ifdef SIGIO
-	  if (interrupt_input)
+	  if (interrupt_input && !wait)
 	    {
 	      sigblockx (SIGIO);
 	      set_waiting_for_input (0);
@@ -840,7 +871,9 @@ kbd_buffer_get_char ()
 #endif /* not SIGIO */
 #endif /* subprocesses */
 
-	  if (!interrupt_input && !kbd_count)
+	  /* Don't block reading if threads are waiting to go on.  */
+	  if (!interrupt_input && !kbd_count
+	      && (!wait || detect_input_pending ()))
 	    {
 	      read_avail_input ();
 	    }
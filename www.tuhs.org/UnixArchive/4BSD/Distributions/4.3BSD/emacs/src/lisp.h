@@ -146,7 +146,17 @@ enum Lisp_Type
 
     /* Window used for Emacs display.
        Data inside looks like a Lisp_Vector.  */
-    Lisp_Window
+    Lisp_Window,
+
+    /* Hash table made by make-hash-table.
+       obj.v.hash_table points to a struct Lisp_Hash_Table,
+       which looks like a Lisp_Vector to the allocator.  */
+    Lisp_Hash_Table,
+
+    /* Keyword matcher made by make-keyword-matcher.
+       obj.v.keyword_matcher points to a struct Lisp_Keyword_Matcher,
+       which looks like a Lisp_Vector to the allocator.  */
+    Lisp_Keyword_Matcher
   };
 
 #ifndef NO_UNION_TYPE
@@ -326,6 +336,8 @@ Lisp_Object;
 #define XINTPTR(a) ((int *) XUINT(a))
 #define XWINDOW(a) ((struct window *) XUINT(a))
 #define XPROCESS(a) ((struct Lisp_Process *) XUINT(a))
+#define XHASH_TABLE(a) ((struct Lisp_Hash_Table *) XUINT(a))
+#define XKEYWORD_MATCHER(a) ((struct Lisp_Keyword_Matcher *) XUINT(a))
 
 #define XSETCONS(a, b) XSETUINT(a, (int) (b))
 #define XSETBUFFER(a, b) XSETUINT(a, (int) (b))
@@ -339,6 +351,8 @@ Lisp_Object;
 #define XSETINTPTR(a, b) XSETUINT(a, (int) (b))
 #define XSETWINDOW(a, b) XSETUINT(a, (int) (b))
 #define XSETPROCESS(a, b) XSETUINT(a, (int) (b))
+#define XSETHASH_TABLE(a, b) XSETUINT(a, (int) (b))
+#define XSETKEYWORD_MATCHER(a, b) XSETUINT(a, (int) (b))
 
 /* In a cons, the markbit of the car is the gc mark bit */
 
@@ -381,6 +395,7 @@ struct Lisp_Symbol
     Lisp_Object function;
     Lisp_Object plist;
     struct Lisp_Symbol *next;	/* -> next symbol in this obarray bucket */
+    int hash;			/* hash_string of name, set when interned */
   };
 
 struct Lisp_Subr
@@ -402,6 +417,45 @@ struct Lisp_Marker
     int modified;
   };
 
+/* A hash table is open addressed.  key_and_value holds the keys
+ in its even slots and the values in the odd slots after them.
+ An empty slot has Qunbound as both key and value;
+ a slot whose entry was removed has Qunbound as key and nil as value.
+ Its number of slots is always twice a power of two.  */
+
+struct Lisp_Hash_Table
+  {
+    int size;
+    struct Lisp_Vector *v_next;
+    /* eq, eql or equal: how keys are compared */
+    Lisp_Object test;
+    /* Number of entries in the table */
+    Lisp_Object count;
+    /* Number of slots holding entries or removed entries */
+    Lisp_Object used;
+    /* The vector of keys and values described above */
+    Lisp_Object key_and_value;
+    /* Non-nil if garbage collection moved some key whose hash code
+       depends on its address, so the table must be rehashed before use */
+    Lisp_Object rehash;
+  };
+
+/* A keyword matcher is an Aho-Corasick automaton for a set of strings.
+ Its tables are ints kept in a string, laid out as described in search.c,
+ so the garbage collector does not look through them.  */
+
+struct Lisp_Keyword_Matcher
+  {
+    int size;
+    struct Lisp_Vector *v_next;
+    /* Vector of the strings to look for */
+    Lisp_Object words;
+    /* Non-nil if case is ignored, by translating through downcase_table */
+    Lisp_Object fold;
+    /* String holding the tables */
+    Lisp_Object tables;
+  };
+
 /* Data type checking */
 
 #define NULL(x)  (XFASTINT (x) == XFASTINT (Qnil))
@@ -426,6 +480,12 @@ struct Lisp_Marker
 #define CHECK_PROCESS(x, i) \
   { if (XTYPE ((x)) != Lisp_Process) x = wrong_type_argument (Qprocessp, (x)); }
 
+#define CHECK_HASH_TABLE(x, i) \
+  { if (XTYPE ((x)) != Lisp_Hash_Table) x = wrong_type_argument (Qhash_table_p, (x)); }
+
+#define CHECK_KEYWORD_MATCHER(x, i) \
+  { if (XTYPE ((x)) != Lisp_Keyword_Matcher) x = wrong_type_argument (Qkeyword_matcher_p, (x)); }
+
 #define CHECK_NUMBER(x, i) \
   { if (XTYPE ((x)) != Lisp_Int) x = wrong_type_argument (Qintegerp, (x)); }
 
@@ -645,7 +705,7 @@ extern Lisp_Object make_number ();
 extern Lisp_Object wrong_type_argument ();
 
 /* Defined in fns.c */
-extern Lisp_Object Qstring_lessp;
+extern Lisp_Object Qstring_lessp, Qeq, Qequal, Qhash_table_p;
 extern Lisp_Object Vfeatures;
 extern Lisp_Object Fidentity (), Frandom ();
 extern Lisp_Object Flength (), Fstring_equal (), Fstring_lessp ();
@@ -657,12 +717,15 @@ extern Lisp_Object Ffillarray (), Fnconc (), Fmapcar (), Fmapconcat ();
 extern Lisp_Object Fy_or_n_p (), Fyes_or_no_p ();
 extern Lisp_Object Ffeaturep (), Frequire () , Fprovide ();
 extern Lisp_Object concat2 (), nconc2 ();
+extern Lisp_Object Fmake_hash_table (), Fgethash (), Fputhash (), Fremhash ();
+extern Lisp_Object Fmaphash (), Fsxhash (), Fhash_table_count (), Fclrhash ();
 
 /* Defined in alloc.c */
 extern Lisp_Object Vpurify_flag;
 extern Lisp_Object Fcons (), Flist(), Fmake_list ();
 extern Lisp_Object Fmake_vector (), Fvector (), Fmake_symbol (), Fmake_marker ();
 extern Lisp_Object Fmake_string (), build_string (), make_string();
+extern Lisp_Object make_uninit_string ();
 extern Lisp_Object Fpurecopy (), make_pure_string ();
 extern Lisp_Object pure_cons (), make_pure_vector ();
 extern Lisp_Object Fgarbage_collect ();
@@ -681,7 +744,9 @@ extern Lisp_Object Fread (), Fread_from_string ();
 extern Lisp_Object Fintern (), Fintern_soft (), Fload ();
 extern Lisp_Object Fget_file_char (), Fread_char ();
 extern Lisp_Object Feval_current_buffer (), Feval_region ();
-extern Lisp_Object intern (), oblookup ();
+extern Lisp_Object intern (), oblookup (), forward_obarray (), unwalk_obarray ();
+extern int obarray_walkers;
+extern int hash_string ();
 
 /* Defined in eval.c */
 extern Lisp_Object Qautoload, Qexit, Qinteractive, Qcommandp, Qdefun, Qmacro;
@@ -701,6 +766,7 @@ extern Lisp_Object call1 (), call2 (), call3 ();
 extern Lisp_Object apply_lambda ();
 extern Lisp_Object internal_catch ();
 extern Lisp_Object internal_condition_case ();
+extern Lisp_Object internal_lisp_condition_case ();
 extern void unbind_to ();
 extern void error ();
 
@@ -715,6 +781,7 @@ extern Lisp_Object Feolp (), Feobp (), Fbolp (), Fbobp (), Fset_mark ();
 extern Lisp_Object Fformat (), format1 ();
 extern Lisp_Object Fgetenv ();
 extern Lisp_Object Fbuffer_substring (), Fbuffer_string ();
+extern Lisp_Object make_buffer_string ();
 extern Lisp_Object save_excursion_save (), save_restriction_save ();
 extern Lisp_Object save_excursion_restore (), save_restriction_restore ();
 extern Lisp_Object Fchar_to_string ();
@@ -747,6 +814,7 @@ extern Lisp_Object Vfundamental_mode_abbrev_table;
 
 extern Lisp_Object Fstring_match ();
 extern Lisp_Object Fscan_buffer ();
+extern Lisp_Object Qkeyword_matcher_p;
 
 /* defined in minibuf.c */
 
@@ -811,10 +879,17 @@ extern Lisp_Object Fsubstitute_command_keys ();
 
 /* defined in bytecode.c */
 extern Lisp_Object Qbytecode;
+extern Lisp_Object Fbyte_code ();
 
 /* defined in macros.c */
 extern Lisp_Object Fexecute_kbd_macro ();
 
+/* defined in thread.c */
+extern int thread_countdown;
+extern int run_threads (), in_background_thread (), thread_output_arrived ();
+extern void thread_preempt (), thread_yield (), thread_sleep ();
+extern void thread_wait_for_output ();
+
 extern void debugger ();
 
 extern char *malloc (), *realloc (), *getenv (), *ctime (), *getwd ();
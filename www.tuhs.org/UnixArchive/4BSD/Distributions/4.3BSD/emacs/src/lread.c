@@ -23,8 +23,15 @@ and this notice must be preserved on all copies.  */
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/file.h>
-#undef NULL
 #include "config.h"
+
+#ifdef NONSYSTEM_DIR_LIBRARY
+#include "ndir.h"
+#else /* not NONSYSTEM_DIR_LIBRARY */
+#include <sys/dir.h>
+#endif /* not NONSYSTEM_DIR_LIBRARY */
+
+#undef NULL
 #include "lisp.h"
 
 #ifndef standalone
@@ -158,11 +165,14 @@ DEFUN ("get-file-char", Fget_file_char, Sget_file_char, 0, 0, 0,
 
 void readevalloop ();
 Lisp_Object load_unwind ();
+static load_binary ();
 
 DEFUN ("load", Fload, Sload, 1, 3, "sLoad file: ",
   "Execute a file of Lisp code named FILE.\n\
 First tries FILE with .elc appended, then tries with .el,\n\
  then tries FILE unmodified.  Searches directories in  load-path.\n\
+A binary load file FILE.elb (see  make-binary-load-file) is used instead\n\
+ of FILE.elc if it is in the same directory and not older.\n\
 If optional second arg MISSING-OK is non-nil,\n\
  report no error if FILE doesn't exist.\n\
 Print messages at start and end of loading unless\n\
@@ -173,7 +183,9 @@ Return t if file exists.")
 {
   register FILE *stream;
   register int fd = -1;
+  int binfd = -1;
   register Lisp_Object lispstream;
+  Lisp_Object found;
   int count = specpdl_ptr - specpdl;
   struct gcpro gcpro1;
 
@@ -184,13 +196,43 @@ Return t if file exists.")
      since it would try to load a directory as a Lisp file */
   if (XSTRING (str)->size > 0)
     {
-      fd = openp (Vload_path, str, ".elc", 0, 0);
+      fd = openp (Vload_path, str, ".elc", &found, 0);
+      if (fd >= 0 && NULL (Vpurify_flag))
+	{
+	  /* Use FILE.elb instead if it is beside FILE.elc
+	     and up to date.  */
+	  struct stat elcst, elbst;
+
+	  found = concat2 (Fsubstring (found, make_number (0),
+				       make_number (XSTRING (found)->size - 1)),
+			   build_string ("b"));
+	  if (fstat (fd, &elcst) >= 0
+	      && stat (XSTRING (found)->data, &elbst) >= 0
+	      && elbst.st_mtime >= elcst.st_mtime)
+	    {
+	      binfd = open (XSTRING (found)->data, 0, 0);
+	      if (binfd >= 0)
+		close (fd);
+	    }
+	}
       if (fd < 0)
 	fd = openp (Vload_path, str, ".el", 0, 0);
       if (fd < 0)
 	fd = openp (Vload_path, str, "", 0, 0);
     }
 
+  if (binfd >= 0)
+    {
+      if (NULL (nomessage))
+	message ("Loading %s...", XSTRING (str)->data);
+      GCPRO1 (str);
+      load_binary (binfd, found);
+      UNGCPRO;
+      if (!noninteractive && NULL (nomessage))
+	message ("Loading %s...done", XSTRING (str)->data);
+      return Qt;
+    }
+
   if (fd < 0)
     if (NULL (missing_ok))
       while (1)
@@ -221,6 +263,83 @@ Return t if file exists.")
   return Qt;
 }
 
+/* Index of the directories in load-path.
+
+   Vload_path_index maps the name of each absolute directory that
+   openp has searched to a vector [FILES MTIME-HIGH MTIME-LOW CHECKED],
+   where FILES is a hash table whose keys are the names of the files
+   in the directory and MTIME is the directory's modification time.
+   A file not in FILES is known not to exist without trying to open it.
+
+   An entry is checked against the directory's modification time at
+   most once a second (CHECKED is the low bits of the time of the last
+   check), and every time if the directory was modified in the second
+   the entry was made.  Writing or renaming a file in Emacs sets
+   load_path_index_stale, to make the next search check all entries.  */
+
+static Lisp_Object Vload_path_index;
+int load_path_index_stale;
+
+extern DIR *opendir ();
+extern struct direct *readdir ();
+extern long time ();
+extern char *index ();
+
+/* Return the FILES table of directory DIR, or nil if DIR
+   cannot be read.  NOW is the current time.  If FORCE is nonzero,
+   always check the directory's modification time.  */
+
+static Lisp_Object
+load_path_dir_files (dir, now, force)
+     Lisp_Object dir;
+     long now;
+     int force;
+{
+  Lisp_Object entry, files;
+  register Lisp_Object *v;
+  struct stat st;
+  register DIR *d;
+  register struct direct *dp;
+
+  entry = Fgethash (dir, Vload_path_index, Qnil);
+  if (!NULL (entry))
+    {
+      v = XVECTOR (entry)->contents;
+      if (!force && XINT (v[3]) == (now & 0xffff))
+	return v[0];
+    }
+
+  if (stat (XSTRING (dir)->data, &st) < 0
+      || (st.st_mode & S_IFMT) != S_IFDIR)
+    {
+      Fremhash (dir, Vload_path_index);
+      return Qnil;
+    }
+
+  if (NULL (entry)
+      || XINT (v[1]) != (st.st_mtime >> 16)
+      || XINT (v[2]) != (st.st_mtime & 0xffff))
+    {
+      if (!(d = opendir (XSTRING (dir)->data)))
+	return Qnil;
+      files = Fmake_hash_table (Qequal, Qnil);
+      while (dp = readdir (d))
+	Fputhash (make_string (dp->d_name, dp->d_namlen), Qt, files);
+      closedir (d);
+
+      entry = Fmake_vector (make_number (4), Qnil);
+      v = XVECTOR (entry)->contents;
+      v[0] = files;
+      v[1] = make_number (st.st_mtime >> 16);
+      v[2] = make_number (st.st_mtime & 0xffff);
+      Fputhash (dir, entry, Vload_path_index);
+    }
+
+  /* A directory modified this second may change again unnoticed.  */
+  v[3] = make_number (st.st_mtime < now ? now & 0xffff : -1);
+  return v[0];
+}
+
 /* exec_only nonzero means don't open the files,
    just look for one that is executable;
    returns 1 on success, having stored a string into *storeptr  */
@@ -240,6 +359,9 @@ openp (path, str, suffix, storeptr, exec_only)
   int want_size;
   register Lisp_Object filename;
   struct stat st;
+  Lisp_Object dir, files, name;
+  long now;
+  int use_index, force;
 
   if (storeptr)
     *storeptr = Qnil;
@@ -247,9 +369,32 @@ openp (path, str, suffix, storeptr, exec_only)
   if (*XSTRING (str)->data == '~' || *XSTRING (str)->data == '/')
     absolute = 1;
 
+  /* The index is used only for names of files directly in the
+     load-path directories.  */
+  use_index = !exec_only && !absolute
+    && !index (XSTRING (str)->data, '/');
+  if (use_index)
+    {
+      if (NULL (Vload_path_index))
+	Vload_path_index = Fmake_hash_table (Qequal, Qnil);
+      now = time (0);
+      force = load_path_index_stale;
+      load_path_index_stale = 0;
+      name = concat2 (str, build_string (suffix));
+    }
+
   for (; !NULL (path); path = Fcdr (path))
     {
-      filename = Fexpand_file_name (str, Fcar (path));
+      dir = Fcar (path);
+      if (use_index && XTYPE (dir) == Lisp_String
+	  && XSTRING (dir)->data[0] == '/')
+	{
+	  files = load_path_dir_files (dir, now, force);
+	  if (!NULL (files) && NULL (Fgethash (name, files, Qnil)))
+	    continue;
+	}
+
+      filename = Fexpand_file_name (str, dir);
 
       want_size = strlen (suffix) + XSTRING (filename)->size + 1;
       if (fn_size < want_size)
@@ -357,6 +502,589 @@ readevalloop (readcharfun, stream, evalfun, printflag)
   unbind_to (count);
 }
 
+/* Binary load files.
+
+   A binary load file holds the same forms as a .elc file, already
+   parsed.  Its contents are the magic bytes ELB_MAGIC, the number of
+   symbols, their names, and then the forms up to end of file.
+   Integers in the file are 4 bytes, least significant first; a
+   string is its length followed by its bytes.  Each object begins
+   with one of the ELB_ tag bytes below.  A list is written as the
+   number of its elements, the elements, and its final cdr, so that
+   long lists need no recursion.  Symbols are written as indices in
+   the symbol table, which is interned once when the file is loaded.
+
+   load uses FILE.elb in place of FILE.elc when they are in the same
+   directory and the .elb is not older.  The whole file is read with
+   one system call and decoded in one pass.
+
+   The byte code of a function defined by a top-level defun or defmacro
+   is not decoded when the file is loaded.  Each (byte-code STRING
+   VECTOR DEPTH) form in it is replaced by (lazy-byte-code REF POS LEN
+   DEPTH), which reads the string and vector from LEN bytes at offset
+   POS of the file the first time it is evaluated, much as doc strings
+   are fetched by get_doc_string.  REF is a vector shared by all the
+   functions of a file: [SYMBOLS FILENAME MTIME-HIGH MTIME-LOW].  */
+
+#define ELB_MAGIC "\377ELB\001"
+#define ELB_MAGIC_SIZE 5
+
+#define ELB_INT 0
+#define ELB_SYMBOL 1
+#define ELB_STRING 2
+#define ELB_LIST 3
+#define ELB_VECTOR 4
+
+/* Byte code shorter than this many bytes in the file
+   is loaded at once.  */
+#define ELB_DEFER_MIN 100
+
+/* Nonzero means defer loading function bodies from binary load files.  */
+int lazy_load_function_bodies;
+
+Lisp_Object Qlazy_byte_code, Qdefmacro;
+
+/* State of one decoding.  */
+
+struct elb
+  {
+    unsigned char *ptr, *end;
+    unsigned char *base;	/* Start of the file */
+    Lisp_Object symbols;	/* Vector of the file's symbols */
+    Lisp_Object name;		/* File name, for error messages */
+    Lisp_Object ref;		/* REF of lazy-byte-code forms */
+    int defer;			/* Nonzero to make lazy-byte-code forms */
+  };
+
+static
+elb_corrupt (s)
+     struct elb *s;
+{
+  error ("Invalid binary load file %s", XSTRING (s->name)->data);
+}
+
+static int
+elb_int (s)
+     register struct elb *s;
+{
+  register unsigned char *p = s->ptr;
+
+  if (s->end - p < 4)
+    elb_corrupt (s);
+  s->ptr += 4;
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+static Lisp_Object
+elb_string (s)
+     register struct elb *s;
+{
+  register int len = elb_int (s);
+  Lisp_Object val;
+
+  if (len < 0 || s->end - s->ptr < len)
+    elb_corrupt (s);
+  val = make_string (s->ptr, len);
+  s->ptr += len;
+  return val;
+}
+
+static Lisp_Object elb_decode ();
+
+/* Skip over one object.  */
+
+static
+elb_skip (s)
+     register struct elb *s;
+{
+  register int n;
+
+  if (s->ptr >= s->end)
+    elb_corrupt (s);
+  switch (*s->ptr++)
+    {
+    case ELB_INT:
+    case ELB_SYMBOL:
+      elb_int (s);
+      return;
+
+    case ELB_STRING:
+      n = elb_int (s);
+      if (n < 0 || s->end - s->ptr < n)
+	elb_corrupt (s);
+      s->ptr += n;
+      return;
+
+    case ELB_LIST:
+      n = elb_int (s) + 1;
+      break;
+
+    case ELB_VECTOR:
+      n = elb_int (s);
+      break;
+
+    default:
+      elb_corrupt (s);
+    }
+  if (n < 0)
+    elb_corrupt (s);
+  while (--n >= 0)
+    elb_skip (s);
+}
+
+/* Having just decoded the symbol byte-code at the head of a list
+   of N elements, return a lazy-byte-code form for the rest of the list
+   if it is worth deferring, or nil.  */
+
+static Lisp_Object
+elb_defer (s, n)
+     register struct elb *s;
+     int n;
+{
+  register unsigned char *start = s->ptr;
+  Lisp_Object depth;
+  int len;
+
+  if (n != 4 || s->ptr >= s->end || *s->ptr != ELB_STRING)
+    return Qnil;
+  elb_skip (s);
+  elb_skip (s);
+  len = s->ptr - start;
+  if (len < ELB_DEFER_MIN)
+    {
+      s->ptr = start;
+      return Qnil;
+    }
+  depth = elb_decode (s);
+  if (!NULL (elb_decode (s)))
+    elb_corrupt (s);
+  return Fcons (Qlazy_byte_code,
+		Fcons (s->ref,
+		       Fcons (make_number (start - s->base),
+			      Fcons (make_number (len),
+				     Fcons (depth, Qnil)))));
+}
+
+static Lisp_Object
+elb_decode (s)
+     register struct elb *s;
+{
+  register int n, i;
+  Lisp_Object val, tail, tem;
+
+  if (s->ptr >= s->end)
+    elb_corrupt (s);
+  switch (*s->ptr++)
+    {
+    case ELB_INT:
+      return make_number (elb_int (s));
+
+    case ELB_SYMBOL:
+      n = elb_int (s);
+      if (n < 0 || n >= XVECTOR (s->symbols)->size)
+	elb_corrupt (s);
+      return XVECTOR (s->symbols)->contents[n];
+
+    case ELB_STRING:
+      return elb_string (s);
+
+    case ELB_LIST:
+      n = elb_int (s);
+      if (n <= 0)
+	elb_corrupt (s);
+      tem = elb_decode (s);
+      if (s->defer && EQ (tem, Qbytecode)
+	  && (val = elb_defer (s, n), !NULL (val)))
+	return val;
+      val = tail = Fcons (tem, Qnil);
+      for (i = 1; i < n; i++)
+	{
+	  tem = Fcons (elb_decode (s), Qnil);
+	  XCONS (tail)->cdr = tem;
+	  tail = tem;
+	}
+      XCONS (tail)->cdr = elb_decode (s);
+      return val;
+
+    case ELB_VECTOR:
+      n = elb_int (s);
+      if (n < 0 || s->end - s->ptr < n)
+	elb_corrupt (s);
+      val = Fmake_vector (make_number (n), Qnil);
+      for (i = 0; i < n; i++)
+	XVECTOR (val)->contents[i] = elb_decode (s);
+      return val;
+    }
+  elb_corrupt (s);
+}
+
+Lisp_Object
+load_binary_unwind (buf)  /* used as unwind-protect function in load */
+     Lisp_Object buf;
+{
+  free ((char *) XUINT (buf));
+  load_in_progress = 0;
+  return Qnil;
+}
+
+/* Load the binary load file open on FD, whose name is NAME.  */
+
+static
+load_binary (fd, name)
+     int fd;
+     Lisp_Object name;
+{
+  struct elb s;
+  struct stat st;
+  register char *buf;
+  register int i, n;
+  Lisp_Object bufobj, tem;
+  int count = specpdl_ptr - specpdl;
+  struct gcpro gcpro1, gcpro2, gcpro3;
+
+  if (fstat (fd, &st) < 0
+      || (buf = (char *) malloc (st.st_size + 1)) == 0)
+    {
+      close (fd);
+      error ("Cannot read %s", XSTRING (name)->data);
+    }
+  n = read (fd, buf, st.st_size);
+  close (fd);
+  XSET (bufobj, Lisp_Internal_Stream, (int) buf);
+  record_unwind_protect (load_binary_unwind, bufobj);
+  load_in_progress = 1;
+
+  s.ptr = s.base = (unsigned char *) buf;
+  s.end = s.ptr + (n < 0 ? 0 : n);
+  s.symbols = Qnil;
+  s.name = name;
+  s.ref = Qnil;
+  s.defer = 0;
+  GCPRO3 (s.symbols, s.name, s.ref);
+
+  if (s.end - s.ptr < ELB_MAGIC_SIZE
+      || bcmp (s.ptr, ELB_MAGIC, ELB_MAGIC_SIZE))
+    elb_corrupt (&s);
+  s.ptr += ELB_MAGIC_SIZE;
+
+  n = elb_int (&s);
+  if (n < 0 || s.end - s.ptr < n * 4)
+    elb_corrupt (&s);
+  s.symbols = Fmake_vector (make_number (n), Qnil);
+  for (i = 0; i < n; i++)
+    XVECTOR (s.symbols)->contents[i] = Fintern (elb_string (&s), Qnil);
+
+  s.ref = Fmake_vector (make_number (4), Qnil);
+  XVECTOR (s.ref)->contents[0] = s.symbols;
+  XVECTOR (s.ref)->contents[1] = name;
+  XVECTOR (s.ref)->contents[2] = make_number (st.st_mtime >> 16);
+  XVECTOR (s.ref)->contents[3] = make_number (st.st_mtime & 0xffff);
+
+  while (s.ptr < s.end)
+    {
+      /* Defer function bodies only in top-level defuns and defmacros,
+	 recognized by their first element.  */
+      s.defer = 0;
+      if (lazy_load_function_bodies
+	  && s.end - s.ptr >= 10
+	  && s.ptr[0] == ELB_LIST && s.ptr[5] == ELB_SYMBOL)
+	{
+	  n = s.ptr[6] | (s.ptr[7] << 8) | (s.ptr[8] << 16) | (s.ptr[9] << 24);
+	  if (n >= 0 && n < XVECTOR (s.symbols)->size)
+	    {
+	      tem = XVECTOR (s.symbols)->contents[n];
+	      s.defer = EQ (tem, Qdefun) || EQ (tem, Qdefmacro);
+	    }
+	}
+      Feval (elb_decode (&s));
+    }
+
+  UNGCPRO;
+  unbind_to (count);
+}
+
+Lisp_Object
+lazy_byte_code_unwind (buf)
+     Lisp_Object buf;
+{
+  free ((char *) XUINT (buf));
+  return Qnil;
+}
+
+DEFUN ("lazy-byte-code", Flazy_byte_code, Slazy_byte_code, 0, UNEVALLED, 0,
+  "Run byte code whose loading was deferred by  load.\n\
+The first time, read the code from the binary load file it came from\n\
+and store it into this form, which thereafter runs it at once.")
+  (args)
+     Lisp_Object args;
+{
+  Lisp_Object ref, bytestr, vector, bufobj, tail;
+  register Lisp_Object *v;
+  struct elb t;
+  struct stat st;
+  register int fd, len;
+  register char *buf;
+  int count = specpdl_ptr - specpdl;
+  struct gcpro gcpro1, gcpro2, gcpro3;
+
+  ref = Fcar (args);
+  if (XTYPE (ref) == Lisp_String)
+    return Fbyte_code (ref, Fcar (Fcdr (args)), Fcar (Fcdr (Fcdr (args))));
+
+  if (XTYPE (ref) != Lisp_Vector || XVECTOR (ref)->size != 4)
+    ref = wrong_type_argument (Qvectorp, ref);
+  v = XVECTOR (ref)->contents;
+  len = XINT (Fcar (Fcdr (Fcdr (args))));
+
+  fd = open (XSTRING (v[1])->data, 0, 0);
+  if (fd < 0)
+    report_file_error ("Opening binary load file", Fcons (v[1], Qnil));
+  if (fstat (fd, &st) < 0
+      || XINT (v[2]) != (st.st_mtime >> 16)
+      || XINT (v[3]) != (st.st_mtime & 0xffff))
+    {
+      close (fd);
+      error ("%s has changed since it was loaded; load it again",
+	     XSTRING (v[1])->data);
+    }
+  buf = (char *) malloc (len);
+  if (buf == 0)
+    {
+      close (fd);
+      error ("Cannot read %s", XSTRING (v[1])->data);
+    }
+  XSET (bufobj, Lisp_Internal_Stream, (int) buf);
+  record_unwind_protect (lazy_byte_code_unwind, bufobj);
+  if (lseek (fd, XINT (Fcar (Fcdr (args))), 0) < 0
+      || read (fd, buf, len) != len)
+    {
+      close (fd);
+      error ("Cannot read %s", XSTRING (v[1])->data);
+    }
+  close (fd);
+
+  t.ptr = t.base = (unsigned char *) buf;
+  t.end = t.ptr + len;
+  t.symbols = v[0];
+  t.name = v[1];
+  t.ref = Qnil;
+  t.defer = 0;
+  bytestr = vector = Qnil;
+  GCPRO3 (args, bytestr, vector);
+  bytestr = elb_decode (&t);
+  vector = elb_decode (&t);
+  if (XTYPE (bytestr) != Lisp_String || XTYPE (vector) != Lisp_Vector)
+    elb_corrupt (&t);
+  UNGCPRO;
+  unbind_to (count);
+
+  /* Turn ARGS, (REF POS LEN DEPTH), into (BYTESTR VECTOR DEPTH).  */
+  tail = XCONS (XCONS (args)->cdr)->cdr;
+  XCONS (tail)->car = Fcar (XCONS (tail)->cdr);
+  XCONS (tail)->cdr = Qnil;
+  XCONS (XCONS (args)->cdr)->car = vector;
+  XCONS (args)->car = bytestr;
+  return Fbyte_code (bytestr, vector, XCONS (tail)->car);
+}
+
+/* Writing binary load files.  */
+
+static Lisp_Object elb_forms;
+
+static Lisp_Object
+elb_collect_form (form)
+     Lisp_Object form;
+{
+  elb_forms = Fcons (form, elb_forms);
+  return Qnil;
+}
+
+Lisp_Object
+elb_close_unwind (stream)
+     Lisp_Object stream;
+{
+  fclose ((FILE *) XUINT (stream));
+  return Qnil;
+}
+
+/* Give each symbol in OBJ an index in TABLE, pushing new ones on *NAMES.  */
+
+static
+elb_collect_symbols (obj, table, names)
+     Lisp_Object obj, table, *names;
+{
+  register int i;
+
+  while (1)
+    switch (XTYPE (obj))
+      {
+      case Lisp_Symbol:
+	if (NULL (Fgethash (obj, table, Qnil)))
+	  {
+	    Fputhash (obj, Fhash_table_count (table), table);
+	    *names = Fcons (obj, *names);
+	  }
+	return;
+
+      case Lisp_Cons:
+	elb_collect_symbols (XCONS (obj)->car, table, names);
+	obj = XCONS (obj)->cdr;
+	break;
+
+      case Lisp_Vector:
+	for (i = 0; i < XVECTOR (obj)->size; i++)
+	  elb_collect_symbols (XVECTOR (obj)->contents[i], table, names);
+	return;
+
+      case Lisp_Int:
+      case Lisp_String:
+	return;
+
+      default:
+	error ("Cannot write this object in a binary load file");
+      }
+}
+
+static
+elb_write_int (n, out)
+     register int n;
+     register FILE *out;
+{
+  putc (n & 0377, out);
+  putc ((n >> 8) & 0377, out);
+  putc ((n >> 16) & 0377, out);
+  putc ((n >> 24) & 0377, out);
+}
+
+static
+elb_write_string (str, out)
+     Lisp_Object str;
+     FILE *out;
+{
+  elb_write_int (XSTRING (str)->size, out);
+  fwrite (XSTRING (str)->data, 1, XSTRING (str)->size, out);
+}
+
+static
+elb_encode (obj, table, out)
+     Lisp_Object obj, table;
+     register FILE *out;
+{
+  register int i;
+  register Lisp_Object tail;
+
+  switch (XTYPE (obj))
+    {
+    case Lisp_Int:
+      putc (ELB_INT, out);
+      elb_write_int (XINT (obj), out);
+      break;
+
+    case Lisp_Symbol:
+      putc (ELB_SYMBOL, out);
+      elb_write_int (XINT (Fgethash (obj, table, Qnil)), out);
+      break;
+
+    case Lisp_String:
+      putc (ELB_STRING, out);
+      elb_write_string (obj, out);
+      break;
+
+    case Lisp_Cons:
+      putc (ELB_LIST, out);
+      for (i = 0, tail = obj; XTYPE (tail) == Lisp_Cons;
+	   tail = XCONS (tail)->cdr)
+	i++;
+      elb_write_int (i, out);
+      for (tail = obj; XTYPE (tail) == Lisp_Cons; tail = XCONS (tail)->cdr)
+	elb_encode (XCONS (tail)->car, table, out);
+      elb_encode (tail, table, out);
+      break;
+
+    case Lisp_Vector:
+      putc (ELB_VECTOR, out);
+      elb_write_int (XVECTOR (obj)->size, out);
+      for (i = 0; i < XVECTOR (obj)->size; i++)
+	elb_encode (XVECTOR (obj)->contents[i], table, out);
+      break;
+    }
+}
+
+DEFUN ("make-binary-load-file", Fmake_binary_load_file, Smake_binary_load_file,
+  1, 2, "fMake binary load file from: ",
+  "Write the forms in Lisp file FILE to a binary load file OUTFILE.\n\
+OUTFILE defaults to FILE with .elc replaced by .elb, or .elb appended.\n\
+load  uses FILE.elb in place of FILE.elc when they are in the same\n\
+directory and FILE.elb is not older; it loads much faster.")
+  (file, outfile)
+     Lisp_Object file, outfile;
+{
+  register FILE *stream;
+  Lisp_Object lispstream, forms, table, names, tail;
+  int count = specpdl_ptr - specpdl;
+  int size;
+  struct gcpro gcpro1, gcpro2, gcpro3, gcpro4, gcpro5;
+
+  CHECK_STRING (file, 0);
+  file = Fexpand_file_name (file, Qnil);
+  if (NULL (outfile))
+    {
+      size = XSTRING (file)->size;
+      if (size > 4 && !strcmp (XSTRING (file)->data + size - 4, ".elc"))
+	{
+	  outfile = Fsubstring (file, make_number (0),
+				make_number (size - 1));
+	  outfile = concat2 (outfile, build_string ("b"));
+	}
+      else
+	outfile = concat2 (file, build_string (".elb"));
+    }
+  else
+    {
+      CHECK_STRING (outfile, 1);
+      outfile = Fexpand_file_name (outfile, Qnil);
+    }
+
+  forms = table = names = Qnil;
+  GCPRO5 (file, outfile, forms, table, names);
+
+  stream = fopen (XSTRING (file)->data, "r");
+  if (stream == 0)
+    report_file_error ("Opening input file", Fcons (file, Qnil));
+  XSET (lispstream, Lisp_Internal_Stream, (int) stream);
+  record_unwind_protect (elb_close_unwind, lispstream);
+  elb_forms = Qnil;
+  readevalloop (Qget_file_char, stream, elb_collect_form, 0);
+  forms = Fnreverse (elb_forms);
+  elb_forms = Qnil;
+  unbind_to (count);
+
+  table = Fmake_hash_table (Qeq, Qnil);
+  for (tail = forms; !NULL (tail); tail = XCONS (tail)->cdr)
+    elb_collect_symbols (XCONS (tail)->car, table, &names);
+  names = Fnreverse (names);
+
+  stream = fopen (XSTRING (outfile)->data, "w");
+  if (stream == 0)
+    report_file_error ("Opening output file", Fcons (outfile, Qnil));
+  XSET (lispstream, Lisp_Internal_Stream, (int) stream);
+  record_unwind_protect (elb_close_unwind, lispstream);
+
+  fwrite (ELB_MAGIC, 1, ELB_MAGIC_SIZE, stream);
+  elb_write_int (XFASTINT (Fhash_table_count (table)), stream);
+  for (tail = names; !NULL (tail); tail = XCONS (tail)->cdr)
+    elb_write_string (Fsymbol_name (XCONS (tail)->car), stream);
+  for (tail = forms; !NULL (tail); tail = XCONS (tail)->cdr)
+    elb_encode (XCONS (tail)->car, table, stream);
+
+  fflush (stream);
+  if (ferror (stream))
+    report_file_error ("Writing output file", Fcons (outfile, Qnil));
+  unbind_to (count);
+  UNGCPRO;
+  return outfile;
+}
+
 #ifndef standalone
 
 DEFUN ("eval-current-buffer", Feval_current_buffer, Seval_current_buffer, 0, 1, "",
@@ -825,15 +1553,48 @@ read_escape (readcharfun)
 Lisp_Object Vobarray;
 Lisp_Object initial_obarray;
 
+/* Number of symbols interned in initial_obarray.
+   When this gets too large for the number of buckets,
+   initial_obarray is replaced by a bigger one.  */
+static int obarray_count;
+
+/* Nonzero while some loop is walking down the buckets of an obarray.
+   Growing the obarray would relink the chains under it,
+   so growth is put off until nobody is walking.  */
+int obarray_walkers;
+
+/* Value of hash_string computed by the last call to oblookup.  */
+static int oblookup_last_hash;
+
 /* CHECK_OBARRAY assumes the variable `tem' is available */
 #define CHECK_OBARRAY(obarray) \
   if (XTYPE (obarray) != Lisp_Vector) \
     { tem = obarray; obarray = initial_obarray; \
       wrong_type_argument (Qvectorp, tem); }
 
-static int hash_string ();
+/* An obarray that has been grown is left holding its replacement
+   in its first bucket, where no symbol can ever be.
+   This way anything still pointing at the old vector still works.  */
+#define OBARRAY_FORWARDED(obarray) \
+  (XVECTOR (obarray)->size > 0 \
+   && XTYPE (XVECTOR (obarray)->contents[0]) == Lisp_Vector)
+
+int hash_string ();
+static void grow_obarray ();
 Lisp_Object oblookup ();
 
+/* Return the obarray that OBARRAY has become.
+   That is OBARRAY itself unless it has been grown.  */
+
+Lisp_Object
+forward_obarray (obarray)
+     register Lisp_Object obarray;
+{
+  while (XTYPE (obarray) == Lisp_Vector && OBARRAY_FORWARDED (obarray))
+    obarray = XVECTOR (obarray)->contents[0];
+  return obarray;
+}
+
 Lisp_Object
 intern (str)
      char *str;
@@ -869,6 +1630,7 @@ it defaults to the value of  obarray.")
 
   CHECK_STRING (str, 0);
 
+  obarray = forward_obarray (obarray);
   tem = oblookup (obarray, XSTRING (str)->data, XSTRING (str)->size);
   if (XTYPE (tem) != Lisp_Int)
     return tem;
@@ -876,6 +1638,7 @@ it defaults to the value of  obarray.")
   if (!NULL (Vpurify_flag))
     str = Fpurecopy (str);
   sym = Fmake_symbol (str);
+  XSYMBOL (sym)->hash = oblookup_last_hash;
 
   ptr = &XVECTOR (obarray)->contents[XINT (tem)];
   if (XTYPE (*ptr) == Lisp_Symbol)
@@ -883,6 +1646,11 @@ it defaults to the value of  obarray.")
   else
     XSYMBOL (sym)->next = 0;
   *ptr = sym;
+
+  if (EQ (obarray, initial_obarray)
+      && ++obarray_count > 2 * XVECTOR (obarray)->size
+      && !obarray_walkers)
+    grow_obarray ();
   return sym;
 }
 
@@ -911,6 +1679,11 @@ it defaults to the value of  obarray.")
   return Qnil;
 }
 
+/* Look up the symbol named by PTR and SIZE in OBARRAY.
+   Return it if found; otherwise return the bucket index, as an integer,
+   in which such a symbol belongs.  Either way, the full hash code
+   of the name is left in oblookup_last_hash for Fintern's use.  */
+
 Lisp_Object
 oblookup (obarray, ptr, size)
      Lisp_Object obarray;
@@ -918,15 +1691,22 @@ oblookup (obarray, ptr, size)
      register int size;
 {
   int hash, obsize;
+  register int fullhash;
   register Lisp_Object tail;
   Lisp_Object bucket, tem;
 
-  if (XTYPE (obarray) != Lisp_Vector || !(obsize = XVECTOR (obarray)->size))
+  if (XTYPE (obarray) != Lisp_Vector)
     error ("Invalid obarray");
-  hash = hash_string (ptr, size) % obsize;
+  obarray = forward_obarray (obarray);
+  if (!(obsize = XVECTOR (obarray)->size))
+    error ("Invalid obarray");
+  fullhash = hash_string (ptr, size);
+  oblookup_last_hash = fullhash;
+  hash = fullhash % obsize;
   bucket = XVECTOR (obarray)->contents[hash];
   for (tail = bucket; XSYMBOL (tail); XSETSYMBOL (tail, XSYMBOL (tail)->next))
     {
+      if (XSYMBOL (tail)->hash != fullhash) continue;
       if (XSYMBOL (tail)->name->size != size) continue;
       if (bcmp (XSYMBOL (tail)->name->data, ptr, size)) continue;
       return tail;
@@ -936,25 +1716,75 @@ oblookup (obarray, ptr, size)
   return tem;
 }
 
-static int
+/* This is the FNV-1a hash, which spreads similar names
+   (such as the many symbols sharing a package prefix)
+   over all the buckets much better than a shift-and-add.  */
+
+int
 hash_string (ptr, len)
      unsigned char *ptr;
      int len;
 {
   register unsigned char *p = ptr;
   register unsigned char *end = p + len;
-  register unsigned char c;
-  register int hash = 0;
+  register unsigned long hash = 2166136261;
 
   while (p != end)
     {
-      c = *p++;
-      if (c >= 0140) c -= 40;
-      hash = ((hash<<3) + (hash>>28) + c);
+      hash ^= *p++;
+      hash *= 16777619;
     }
   return hash & 07777777777;
 }
 
+/* Replace initial_obarray with one twice as big,
+   moving all its symbols into the new one.
+   Uses the hash code saved in each symbol, so no names are rehashed.  */
+
+static void
+grow_obarray ()
+{
+  Lisp_Object oldvec, newvec, len;
+  register Lisp_Object *ptr;
+  register struct Lisp_Symbol *sym, *next;
+  register int i, oldsize, newsize;
+
+  oldvec = initial_obarray;
+  oldsize = XVECTOR (oldvec)->size;
+  newsize = 2 * oldsize + 1;
+  XFASTINT (len) = newsize;
+  newvec = Fmake_vector (len, make_number (0));
+
+  for (i = 0; i < oldsize; i++)
+    {
+      ptr = &XVECTOR (oldvec)->contents[i];
+      sym = XTYPE (*ptr) == Lisp_Symbol ? XSYMBOL (*ptr) : 0;
+      for (; sym; sym = next)
+	{
+	  next = sym->next;
+	  ptr = &XVECTOR (newvec)->contents[sym->hash % newsize];
+	  sym->next = XTYPE (*ptr) == Lisp_Symbol ? XSYMBOL (*ptr) : 0;
+	  XSET (*ptr, Lisp_Symbol, sym);
+	}
+      XFASTINT (XVECTOR (oldvec)->contents[i]) = 0;
+    }
+
+  XVECTOR (oldvec)->contents[0] = newvec;
+  if (EQ (Vobarray, oldvec))
+    Vobarray = newvec;
+  initial_obarray = newvec;
+}
+
+/* Used as unwind-protect function by things that walk obarray buckets.  */
+
+Lisp_Object
+unwalk_obarray (ignore)
+     Lisp_Object ignore;
+{
+  obarray_walkers--;
+  return Qnil;
+}
+
 void
 map_obarray (obarray, fn, arg)
      Lisp_Object obarray;
@@ -963,12 +1793,18 @@ map_obarray (obarray, fn, arg)
 {
   register int i;
   register Lisp_Object tail;
+  int count = specpdl_ptr - specpdl;
+
   CHECK_VECTOR (obarray, 1);
+  obarray = forward_obarray (obarray);
+  record_unwind_protect (unwalk_obarray, Qnil);
+  obarray_walkers++;
   for (i = XVECTOR (obarray)->size - 1; i >= 0; i--)
     for (tail = XVECTOR (obarray)->contents[i];
 	 XTYPE (tail) == Lisp_Symbol && XSYMBOL (tail);
 	 XSETSYMBOL (tail, XSYMBOL (tail)->next))
       (*fn) (tail, arg);
+  unbind_to (count);
 }
 
 mapatoms_1 (sym, function)
@@ -1013,10 +1849,13 @@ init_obarray ()
   initial_obarray = Vobarray;
   staticpro (&Vobarray);
   staticpro (&initial_obarray);
+  obarray_count = 1;
+  obarray_walkers = 0;
   /* Intern nil in the obarray */
   /* These locals are to kludge around a pyramid compiler bug. */
-  hash = hash_string ("nil", 3) % OBARRAY_SIZE;
-  tem = &XVECTOR (Vobarray)->contents[hash];
+  hash = hash_string ("nil", 3);
+  XSYMBOL (Qnil)->hash = hash;
+  tem = &XVECTOR (Vobarray)->contents[hash % OBARRAY_SIZE];
   *tem = Qnil;
 
   Qunbound = Fmake_symbol (make_pure_string ("unbound", 7));
@@ -1142,6 +1981,8 @@ syms_of_read ()
   defsubr (&Sintern);
   defsubr (&Sintern_soft);
   defsubr (&Sload);
+  defsubr (&Smake_binary_load_file);
+  defsubr (&Slazy_byte_code);
   defsubr (&Seval_current_buffer);
   defsubr (&Seval_region);
   defsubr (&Sread_char);
@@ -1151,7 +1992,8 @@ syms_of_read ()
   DefLispVar ("obarray", &Vobarray,
     "Symbol table for use by  intern  and  read.\n\
 It is a vector whose length ought to be prime for best results.\n\
-Each element is a list of all interned symbols whose names hash in that bucket.");
+Each element is a list of all interned symbols whose names hash in that bucket.\n\
+The standard obarray is replaced by a bigger one as symbols are added.");
 
   DefLispVar ("values", &Vvalues,
     "List of values of all expressions which were read, evaluated and printed.\n\
@@ -1180,5 +2022,23 @@ otherwise to default specified in by file paths.h when emacs was built.");
   Qget_file_char = intern ("get-file-char");
   staticpro (&Qget_file_char);
 
+  staticpro (&elb_forms);
+  elb_forms = Qnil;
+
+  Qlazy_byte_code = intern ("lazy-byte-code");
+  staticpro (&Qlazy_byte_code);
+  Qdefmacro = intern ("defmacro");
+  staticpro (&Qdefmacro);
+
+  DefBoolVar ("lazy-load-function-bodies", &lazy_load_function_bodies,
+    "*Non-nil means binary load files define functions without reading their code.\n\
+The code of each function is read from the file when it is first called.");
+  lazy_load_function_bodies = 1;
+
+  /* Made by openp when first needed, since hash tables
+     are not available yet.  */
+  Vload_path_index = Qnil;
+  staticpro (&Vload_path_index);
+
   unrch = -1;
 }
@@ -143,10 +143,7 @@ read_minibuf (map, prefix, prompt, expflag)
     }
 
   /* Make minibuffer contents into a string */
-  val = make_string (&CharAt (1), bf_s1 + bf_s2);
-  bcopy (bf_p2 + bf_s1 + 1,
-	 XSTRING (val)->data + bf_s1,
-	 bf_s2);
+  val = make_buffer_string (1, bf_s1 + bf_s2 + 1);
 
   last_minibuf_string = val;
 
@@ -368,6 +365,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
   int index, obsize;
   int matchcount = 0;
   Lisp_Object bucket, zero, end, tem;
+  int count = specpdl_ptr - specpdl;
 
   CHECK_STRING (string, 0);
   if (!list && XTYPE (alist) != Lisp_Vector)
@@ -379,6 +377,10 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
     tail = alist;
   else
     {
+      /* Keep intern from growing the obarray while we walk its buckets.  */
+      alist = forward_obarray (alist);
+      record_unwind_protect (unwalk_obarray, Qnil);
+      obarray_walkers++;
       index = 0;
       obsize = XVECTOR (alist)->size;
       bucket = XVECTOR (alist)->contents[index];
@@ -451,6 +453,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
 	    }
 	}
     }
+  unbind_to (count);
 
   if (NULL (bestmatch))
     return Qnil;		/* No completions found */
@@ -517,6 +520,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
   int list = LISTP (alist);
   int index, obsize;
   Lisp_Object bucket, tem;
+  int count = specpdl_ptr - specpdl;
 
   CHECK_STRING (string, 0);
   if (!list && XTYPE (alist) != Lisp_Vector)
@@ -529,6 +533,10 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
     tail = alist;
   else
     {
+      /* Keep intern from growing the obarray while we walk its buckets.  */
+      alist = forward_obarray (alist);
+      record_unwind_protect (unwalk_obarray, Qnil);
+      obarray_walkers++;
       index = 0;
       obsize = XVECTOR (alist)->size;
       bucket = XVECTOR (alist)->contents[index];
@@ -588,6 +596,7 @@ The argument given to PREDICATE is the alist element or the symbol from the obar
 	  allmatches = Fcons (eltstring, allmatches);
 	}
     }
+  unbind_to (count);
 
   return Fnreverse (allmatches);
 }
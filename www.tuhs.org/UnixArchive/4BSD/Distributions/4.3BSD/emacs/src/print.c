@@ -70,9 +70,11 @@ extern int noninteractive_need_newline;
        old_point = point; \
        SetPoint (marker_position (printcharfun)); \
        start_point = point; \
-       printcharfun = Qnil;}
+       printcharfun = Qnil;}\
+   insbufidx = 0
 
 #define PRINTFINISH \
+   insbuf_flush (); \
    if (XTYPE (original) == Lisp_Marker) \
      Fset_marker (original, make_number (point), Qnil); \
    if (old_point >= 0) \
@@ -87,6 +89,26 @@ static char printbuf[MScreenWidth + 1];
 /* Index of first unused element of above */
 static int printbufidx;
 
+/* Buffer for output destined for the current buffer.
+   Inserting a character at a time means checking the gap, adjusting
+   markers and recording undo for each one, so output is collected here
+   and inserted in batches: when this fills, and in PRINTFINISH.
+   Output discarded by an error is dropped by the next PRINTPREPARE.  */
+#define INSBUF_SIZE 4096
+static char insbuf[INSBUF_SIZE];
+/* Index of first unused element of above */
+static int insbufidx;
+
+static void
+insbuf_flush ()
+{
+  if (insbufidx > 0)
+    {
+      InsCStr (insbuf, insbufidx);
+      insbufidx = 0;
+    }
+}
+
 static void
 printchar (ch, fun)
      unsigned char ch;
@@ -98,7 +120,9 @@ printchar (ch, fun)
   if (EQ (fun, Qnil))
     {
       QUIT;
-      InsCStr (&ch, 1);
+      if (insbufidx == INSBUF_SIZE)
+	insbuf_flush ();
+      insbuf[insbufidx++] = ch;
       return;
     }
   if (EQ (fun, Qt))
@@ -132,7 +156,18 @@ strout (ptr, size, printcharfun)
 
   if (EQ (printcharfun, Qnil))
     {
-      InsCStr (ptr, size >= 0 ? size : strlen (ptr));
+      i = size >= 0 ? size : strlen (ptr);
+      if (i > INSBUF_SIZE - insbufidx)
+	{
+	  insbuf_flush ();
+	  if (i > INSBUF_SIZE)
+	    {
+	      InsCStr (ptr, i);
+	      return;
+	    }
+	}
+      bcopy (ptr, &insbuf[insbufidx], i);
+      insbufidx += i;
       return;
     }
   if (EQ (printcharfun, Qt))
@@ -576,6 +611,19 @@ print (obj, printcharfun, escapeflag)
       break;
 #endif /* standalone */
 
+    case Lisp_Hash_Table:
+      strout ("#<hash-table ", -1, printcharfun);
+      strout (XSYMBOL (XHASH_TABLE (obj)->test)->name->data, -1, printcharfun);
+      sprintf (buf, " %d entries>", XFASTINT (XHASH_TABLE (obj)->count));
+      strout (buf, -1, printcharfun);
+      break;
+
+    case Lisp_Keyword_Matcher:
+      sprintf (buf, "#<keyword-matcher %d words>",
+	       XVECTOR (XKEYWORD_MATCHER (obj)->words)->size);
+      strout (buf, -1, printcharfun);
+      break;
+
     case Lisp_Subr:
       strout ("#<subr ", -1, printcharfun);
       strout (XSUBR (obj)->symbol_name, -1, printcharfun);
@@ -58,6 +58,7 @@ and this notice must be preserved on all copies.  */
 #include "buffer.h"
 #include "process.h"
 #include "termhooks.h"
+#include "regex.h"
 
 /* Define SIGCHLD as an alias for SIGCLD.  There are many conditionals
    testing SIGCHLD.  */
@@ -151,6 +152,10 @@ int input_wait_mask;
 
 int delete_exited_processes;
 
+/* Number of subprocesses that search-files divides its files among */
+
+int search_files_jobs;
+
 #define MAXDESC 32
 
 /* Indexed by descriptor, gives the process (if any) for that descriptor */
@@ -844,6 +849,266 @@ create_process (process, new_argv)
 #endif /* SIGCHLD */
 }
 
+/* Search the NFILES files named in FILES for the pattern in BUFP,
+   and write to descriptor OUT a line "FILE:LINE:COLUMN:TEXT" for each
+   line on which a match starts, where TEXT is that whole line.
+   This runs in a child of Emacs; it must not signal a Lisp error.  */
+
+static
+search_files_1 (bufp, files, nfiles, out)
+     struct re_pattern_buffer *bufp;
+     char **files;
+     int nfiles, out;
+{
+  FILE *stream = fdopen (out, "w");
+  struct stat st;
+  register char *p, *end, *line;
+  char *text = 0;
+  int space = 0;
+  int i, fd, size, n, pos, val, linenum;
+
+  for (i = 0; i < nfiles; i++)
+    {
+      fd = open (files[i], 0);
+      if (fd < 0 || fstat (fd, &st) < 0)
+	{
+	  fprintf (stream, "%s: %s\n", files[i],
+		   errno < sys_nerr ? sys_errlist[errno] : "unknown error");
+	  if (fd >= 0)
+	    close (fd);
+	  continue;
+	}
+      if ((st.st_mode & S_IFMT) != S_IFREG)
+	{
+	  close (fd);
+	  continue;
+	}
+
+      /* Read the whole file, so a match can run across lines.  */
+      if (st.st_size >= space)
+	{
+	  space = st.st_size + 1;
+	  text = text ? (char *) realloc (text, space) : (char *) malloc (space);
+	  if (!text)
+	    {
+	      fprintf (stream, "%s: file too large to search\n", files[i]);
+	      close (fd);
+	      space = 0;
+	      continue;
+	    }
+	}
+      for (size = 0; size < st.st_size; size += n)
+	if ((n = read (fd, text + size, st.st_size - size)) <= 0)
+	  break;
+      close (fd);
+
+      /* regexp-step-limit applies to each file.  */
+      bzero (&re_statistics, sizeof re_statistics);
+
+      /* LINE is the start of line number LINENUM, which contains POS.
+	 After a hit, searching resumes at the next line.  */
+      line = text;
+      linenum = 1;
+      pos = 0;
+      while (pos < size)
+	{
+	  val = re_search (bufp, text, size, pos, size - pos, 0);
+	  if (val == -2)
+	    fprintf (stream, "%s: search took more than regexp-step-limit steps\n",
+		     files[i]);
+	  if (val < 0)
+	    break;
+	  for (p = text + pos, end = text + val; p != end; p++)
+	    if (*p == '\n')
+	      linenum++, line = p + 1;
+	  for (end = text + size; p != end && *p != '\n'; p++);
+	  fprintf (stream, "%s:%d:%d:", files[i], linenum, val - (line - text) + 1);
+	  fwrite (line, 1, p - line, stream);
+	  putc ('\n', stream);
+	  if (p == end)
+	    break;
+	  line = p + 1;
+	  linenum++;
+	  pos = line - text;
+	}
+
+      /* Send each file's hits as soon as it is done.  */
+      fflush (stream);
+    }
+  fclose (stream);
+}
+
+DEFUN ("search-files", Fsearch_files, Ssearch_files, 3, 4, 0,
+  "Search each file in the list FILES for REGEXP, in subprocesses.\n\
+Hits are inserted in BUFFER (a buffer or buffer name) while the search\n\
+goes on, one line for each line of a file on which a match starts:\n\
+  FILE:LINE:COLUMN:TEXT\n\
+where LINE and COLUMN count from 1 and TEXT is the whole line.\n\
+This is the form that \\[next-error] understands.\n\
+Relative file names are relative to the current buffer's default directory.\n\
+The files are divided among JOBS subprocesses, which search at the same\n\
+time; JOBS defaults to search-files-jobs.  Each subprocess takes its share\n\
+of FILES in order, and inserts its hits together and in that order.\n\
+case-fold-search and regexp-step-limit apply, the limit to each file.\n\
+Returns the list of subprocesses.")
+  (regexp, files, buffer, jobs)
+     Lisp_Object regexp, files, buffer, jobs;
+{
+  Lisp_Object tail, name, proc, val;
+  struct re_pattern_buffer *bufp;
+  extern unsigned char downcase_table[];
+  struct re_pattern_buffer *compile_pattern ();
+  register char **names;
+  register int i;
+  int nfiles, njobs, k, pid, inchannel, forkout;
+  int sv[2];
+  int (*sigchld)();
+  unsigned char *temp;
+
+  CHECK_STRING (regexp, 0);
+  nfiles = XINT (Flength (files));
+  names = (char **) alloca ((nfiles + 1) * sizeof (char *));
+  for (i = 0, tail = files; i < nfiles; i++, tail = Fcdr (tail))
+    {
+      name = Fcar (tail);
+      CHECK_STRING (name, 1);
+      names[i] = (char *) XSTRING (name)->data;
+    }
+  if (NULL (jobs))
+    njobs = search_files_jobs;
+  else
+    {
+      CHECK_NUMBER (jobs, 3);
+      njobs = XINT (jobs);
+    }
+  if (njobs > nfiles)
+    njobs = nfiles;
+  if (njobs < 1)
+    njobs = 1;
+  buffer = Fget_buffer_create (buffer);
+
+  bufp = compile_pattern (regexp,
+			  !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
+
+  temp = 0;
+  if (XTYPE (bf_cur->directory) == Lisp_String)
+    {
+      temp = (unsigned char *) alloca (XSTRING (bf_cur->directory)->size + 2);
+      bcopy (XSTRING (bf_cur->directory)->data, temp,
+	     XSTRING (bf_cur->directory)->size);
+      i = XSTRING (bf_cur->directory)->size;
+      if (temp[i - 1] != '/') temp[i++] = '/';
+      temp[i] = 0;
+    }
+
+  val = Qnil;
+  for (k = 0; k < njobs; k++)
+    {
+      proc = make_process (build_string ("search-files"));
+      XPROCESS (proc)->childp = Qt;
+      XPROCESS (proc)->command_channel_p = Qnil;
+      XPROCESS (proc)->buffer = buffer;
+      XPROCESS (proc)->sentinel = Qnil;
+      XPROCESS (proc)->filter = Qnil;
+      XPROCESS (proc)->command = Fcons (build_string ("search-files"),
+					Fcons (regexp, Qnil));
+      XPROCESS (proc)->kill_without_query = Qt;
+
+      if (pipe (sv) < 0)
+	{
+	  remove_process (proc);
+	  report_file_error ("Creating pipe", Qnil);
+	}
+      inchannel = sv[0];
+      forkout = sv[1];
+      if (inchannel >= MAXDESC)
+	{
+	  close (inchannel);
+	  close (forkout);
+	  remove_process (proc);
+	  error ("Too many subprocesses");
+	}
+
+#ifdef FIOCLEX
+      ioctl (inchannel, FIOCLEX, 0);
+#endif
+#ifdef O_NDELAY
+      fcntl (inchannel, F_SETFL, O_NDELAY);
+#endif
+
+      /* Nothing is sent to a search, so it has just the one channel.  */
+      chan_process[inchannel] = proc;
+      XFASTINT (XPROCESS (proc)->infd) = inchannel;
+      XFASTINT (XPROCESS (proc)->outfd) = inchannel;
+      XFASTINT (XPROCESS (proc)->flags) = RUNNING;
+      input_wait_mask |= ChannelMask (inchannel);
+
+#ifdef SIGCHLD
+#ifdef BSD4_1
+      sighold (SIGCHLD);
+#else /* not BSD4_1 */
+#if defined (BSD) || defined (UNIPLUS)
+      sigsetmask (1 << (SIGCHLD - 1));
+#else /* ordinary USG */
+      sigchld = signal (SIGCHLD, SIG_DFL);
+#endif /* ordinary USG */
+#endif /* not BSD4_1 */
+#endif /* SIGCHLD */
+
+      /* The child does real work in a copy of Emacs, so it must fork,
+	 not vfork.  */
+      pid = fork ();
+      if (pid == 0)
+	{
+	  /* There is no exec to close the descriptors marked FIOCLEX,
+	     so close all of them but the pipe.  Otherwise the child
+	     would hold other processes' pipes open while it searches.  */
+#ifdef BSD
+	  i = getdtablesize ();
+#else
+	  i = _NFILE;
+#endif
+	  while (--i >= 0)
+	    if (i != forkout)
+	      close (i);
+	  if (temp)
+	    chdir (temp);
+#ifdef USG
+	  setpgrp ();
+#else
+	  setpgrp (getpid (), getpid ());
+#endif /* USG */
+	  search_files_1 (bufp, names + k * nfiles / njobs,
+			  (k + 1) * nfiles / njobs - k * nfiles / njobs,
+			  forkout);
+	  _exit (0);
+	}
+      close (forkout);
+
+      if (pid < 0)
+	{
+	  remove_process (proc);
+	  report_file_error ("Doing fork", Qnil);
+	}
+      XFASTINT (XPROCESS (proc)->pid) = pid;
+
+#ifdef SIGCHLD
+#ifdef BSD4_1
+      sigrelse (SIGCHLD);
+#else /* not BSD4_1 */
+#if defined (BSD) || defined (UNIPLUS)
+      sigsetmask (0);
+#else /* ordinary USG */
+      signal (SIGCHLD, sigchld);
+#endif /* ordinary USG */
+#endif /* not BSD4_1 */
+#endif /* SIGCHLD */
+
+      val = Fcons (proc, val);
+    }
+  return Fnreverse (val);
+}
+
 deactivate_process (proc)
      Lisp_Object proc;
 {
@@ -873,10 +1138,18 @@ DEFUN ("accept-process-output", Faccept_process_output, Saccept_process_output,
   "Allow any pending output from subprocesses to be read by Emacs.\n\
 It is read into the processs' buffers or given to their filter functions.\n\
 Non-nil arg PROCESS means do not return until some output has been received\n\
-from PROCESS.")
+from PROCESS.\n\
+Background threads run meanwhile.  In a background thread, let the other\n\
+threads run, and come back once some output has been read, or after a second.")
   (proc)
      Lisp_Object proc;
 {
+  if (in_background_thread ())
+    {
+      thread_wait_for_output ();
+      return Qnil;
+    }
+  run_threads ();
   if (NULL (proc))
     wait_reading_process_input (-1, 0, 0);
   else
@@ -1105,6 +1378,10 @@ wait_reading_process_input (time_limit, read_kbd, do_display)
 		{
 		  if (do_display)
 		    DoDsp (1);
+		  /* Return soon, so that threads waiting for output
+		     can have it, unless waiting for a channel.  */
+		  if (thread_output_arrived () && !wait_channel)
+		    time_limit = -1;
 		}
 	      else
 		{
@@ -1756,6 +2033,10 @@ nil means don't delete them until list-processes is done.");
 
   delete_exited_processes = 1;
 
+  DefIntVar ("search-files-jobs", &search_files_jobs,
+    "*Number of subprocesses that search-files divides its files among.");
+  search_files_jobs = 4;
+
   defsubr (&Sprocessp);
   defsubr (&Sget_process);
   defsubr (&Sget_buffer_process);
@@ -1774,6 +2055,7 @@ nil means don't delete them until list-processes is done.");
   defsubr (&Sprocess_kill_without_query);
   defsubr (&Slist_processes);
   defsubr (&Sstart_process);
+  defsubr (&Ssearch_files);
   defsubr (&Saccept_process_output);
   defsubr (&Ssend_region);
   defsubr (&Ssend_string);
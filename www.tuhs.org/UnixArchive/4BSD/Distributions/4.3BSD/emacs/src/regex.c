@@ -63,6 +63,7 @@ what you give them.   Help stamp out software-hoarding!  */
 #include "lisp.h"
 #include "buffer.h"
 #include "syntax.h"
+#include "commands.h"
 
 #else  /* not emacs */
 
@@ -87,6 +88,16 @@ static char syntax_table[256];
 #define NFAILURES 80
 #endif NFAILURES
 
+struct re_statistics re_statistics;
+int re_step_limit;
+
+/* Count N steps of matching, and return -2 from the function
+   if that goes past re_step_limit.  */
+
+#define STEPS(n) \
+  if ((re_statistics.steps += (n)) > re_step_limit && re_step_limit > 0) \
+    return -2; else
+
 /* width of a byte in bits */
 
 #define BYTEWIDTH 8
@@ -205,6 +216,8 @@ enum regexpcode
   }
 
 static int store_jump (), insert_jump ();
+static struct re_automaton *re_automaton ();
+static int automaton_search (), automaton_search_back (), automaton_match ();
 
 char *
 re_compile_pattern (pattern, size, bufp)
@@ -271,6 +284,7 @@ re_compile_pattern (pattern, size, bufp)
   int regnum = 1;
 
   bufp->fastmap_accurate = 0;
+  re_free_automaton (bufp);
 
 #ifndef emacs
   /*
@@ -732,11 +746,16 @@ re_compile_fastmap (bufp)
 
 	case duplicate:
 	  bufp->can_be_null = 1;
-	case anychar:
 	  for (j = 0; j < (1 << BYTEWIDTH); j++)
 	    fastmap[j] = 1;
 	  return;
 
+	case anychar:
+	  /* Other alternatives may still match the null string.  */
+	  for (j = 0; j < (1 << BYTEWIDTH); j++)
+	    fastmap[j] = 1;
+	  break;
+
 	case wordchar:
 	  for (j = 0; j < (1 << BYTEWIDTH); j++)
 	    if (SYNTAX (j) == Sword)
@@ -824,7 +843,7 @@ re_search (pbufp, string, size, startpos, range, regs)
   as to take the starting position outside of the input strings.
 
 The value returned is the position at which the match was found,
- or -1 if no match was found. */
+ or -1 if no match was found, or -2 if re_step_limit ran out first. */
 
 int
 re_search_2 (pbufp, string1, size1, string2, size2, startpos, range, regs, mstop)
@@ -839,11 +858,22 @@ re_search_2 (pbufp, string1, size1, string2, size2, startpos, range, regs, mstop
   register char *fastmap = pbufp->fastmap;
   register char *translate = pbufp->translate;
   int total = size1 + size2;
+  struct re_automaton *automaton = re_automaton (pbufp);
+  int val;
 
   /* Update the fastmap now if not correct already */
   if (fastmap && !pbufp->fastmap_accurate)
     re_compile_fastmap (pbufp);
 
+  /* A forward search is done in one pass if the pattern allows.  */
+  if (automaton && range >= 0)
+    return automaton_search (pbufp, automaton, string1, size1, string2, size2,
+			     startpos, range, regs, mstop);
+
+  if (automaton)
+    return automaton_search_back (pbufp, automaton, string1, size1,
+				  string2, size2, startpos, range, regs, mstop);
+
   while (1)
     {
       /* If a fastmap is supplied, skip quickly over characters
@@ -890,8 +920,11 @@ re_search_2 (pbufp, string1, size1, string2, size2, startpos, range, regs, mstop
 	  && fastmap && !pbufp->can_be_null)
 	return -1;
 
-      if (0 <= re_match_2 (pbufp, string1, size1, string2, size2, startpos, regs, mstop))
+      val = re_match_2 (pbufp, string1, size1, string2, size2, startpos, regs, mstop);
+      if (val >= 0)
 	return startpos;
+      if (val == -2)
+	return -2;
 
     advance:
       if (!range) break;
@@ -919,11 +952,15 @@ re_match (pbufp, string, size, pos, regs)
 
   If pbufp->fastmap is nonzero, then it had better be up to date.
 
+  Patterns that do not need backtracking are matched as automata;
+  see "Matching with automata" below.
+
   The reason that the data to match is specified as two components
   which are to be regarded as concatenated
   is so that this function can be used directly on the contents of an Emacs buffer.
 
-  -1 is returned if there is no match.  Otherwise the value is the length
+  -1 is returned if there is no match, and -2 if re_step_limit ran out
+  before that was known.  Otherwise the value is the length
   of the substring which was matched.
 */
 
@@ -936,6 +973,7 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
      struct re_registers *regs;
      int mstop;
 {
+  struct re_automaton *automaton = re_automaton (pbufp);
   register char *p = pbufp->buffer;
   register char *pend = p + pbufp->used;
   /* End of first string */
@@ -976,6 +1014,12 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
   char *regstart_segend[RE_NREGS];
   char *regend[RE_NREGS];
 
+  if (automaton)
+    return automaton_match (pbufp, automaton, string1, size1, string2, size2,
+			    pos, regs, mstop);
+
+  re_statistics.positions++;
+
   /* Set up pointers to ends of strings.
      Don't allow the second string to be empty unless both are empty.  */
   if (!size2)
@@ -1032,6 +1076,7 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
 
   while (1)
     {
+      STEPS (1);
       if (p == pend)
 	/* End of pattern means we have succeeded! */
 	{
@@ -1197,6 +1242,8 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
 	  mcnt += SIGN_EXTEND_CHAR (*p++) << 8;
 	  *stackp++ = mcnt + p;
 	  *stackp++ = d;
+	  if (stackp - stackb > 2 * re_statistics.max_failures)
+	    re_statistics.max_failures = (stackp - stackb) / 2;
 	  break;
 
 	/* The end of a smart repeat has an maybe_finalize_jump back.
@@ -1262,6 +1309,8 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
 	    }
 	  *stackp++ = 0;
 	  *stackp++ = 0;
+	  if (stackp - stackb > 2 * re_statistics.max_failures)
+	    re_statistics.max_failures = (stackp - stackb) / 2;
 	  goto nofinalize;
 
 	case wordbound:
@@ -1407,6 +1456,7 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
 	    }
 	  d = *--stackp;
 	  p = *--stackp;
+	  re_statistics.backtracks++;
 	  if (d >= string1 && d <= end1)
 	    dend = end_match_1;
 	}
@@ -1415,6 +1465,1399 @@ re_match_2 (pbufp, string1, size1, string2, size2, pos, regs, mstop)
   return -1;         /* Failure to match */
 }
 
+/* Matching with automata.
+
+   Backtracking through a pattern like \(a*\)*b can take time exponential
+   in the length of the text, and needs a failure point for each
+   character that a repetition matches.  So unless a pattern has back
+   references or tests the position of point, which an automaton cannot
+   do, re_search_2 and re_match_2 run it as an automaton instead.
+   Then the time is proportional to the length of the text times the
+   length of the pattern, and the space does not depend on the text.
+
+   The automaton's threads are positions in the compiled pattern: that
+   of a command, or, within an exactn, that of the next byte to match.
+   Position bufp->used is the end of the pattern, where a thread has
+   succeeded.  maybe_finalize_jump, finalize_jump and dummy_failure_jump
+   only keep the backtracking matcher from trying failure points that
+   cannot succeed, so here they are ordinary jumps.
+
+   A forward search first runs a DFA whose states are sets of threads,
+   together with what the character before is, for ^ and \b and the
+   like.  States are made as they are needed and a few dozen are kept.
+   This looks at each character once, and finds where the first match
+   to end ends, or that there is none.  It also finds the last position
+   before that where no thread was alive; no match can start before it.
+
+   From there the threads are simulated one character at a time, each
+   with its own registers, in the order the backtracking matcher would
+   try them.  Of the threads started at the earliest position, the first
+   to reach the end of the pattern is the match the backtracking matcher
+   finds, and its registers are the same -- except that a register is
+   not left as set by an attempt that failed later, and a repetition of
+   something that matches the empty string does not loop forever.  */
+
+#define AUTOMATON_LITERAL 0200	/* Kind of the literal bytes of an exactn */
+#define AUTOMATON_ARG 0201	/* Kind of other argument bytes */
+
+#define END_OF_TEXT 0400	/* Stands for the character after the text */
+
+/* Bits saying what comes before a position */
+#define AT_START 1		/* Nothing; it is the start of the text */
+#define AFTER_NEWLINE 2		/* A newline */
+#define AFTER_WORD 4		/* A word-constituent */
+#define SEARCHING 010		/* In a DFA state, start a new thread here too */
+
+#define DFA_STATES 64		/* Number of DFA states kept for a pattern */
+#define DFA_HASH 32		/* Number of chains for looking them up */
+#define DFA_FLUSHES 8		/* Times one search may discard the states
+				   before it stops using the DFA */
+
+#define NCAPS (2 * RE_NREGS)	/* Register slots for each thread */
+
+/* Emacs searches with immediate_quit set, so C-g can longjmp out of
+   the matcher anywhere.  It must not do that inside malloc or free,
+   or while the DFA states are half made or half discarded, so quits
+   are held off there and taken as soon as the work is done.  */
+
+#ifdef emacs
+#define HOLD_QUIT(saved) ((saved) = immediate_quit, immediate_quit = 0)
+#define RELEASE_QUIT(saved) \
+  if (!(immediate_quit = (saved))) ; else QUIT
+#else
+#define HOLD_QUIT(saved) ((saved) = 0)
+#define RELEASE_QUIT(saved)
+#endif
+
+#define LITERAL_CANDIDATES 64	/* exactns considered for the literal */
+
+/* The position a jump command at PC in pattern B jumps to */
+#define JUMP_TARGET(b, pc) \
+  ((pc) + 3 + (((b)[(pc) + 1] & 0377) + (SIGN_EXTEND_CHAR ((b)[(pc) + 2]) << 8)))
+
+struct dfa_state
+  {
+    struct dfa_state *hash_next;
+    int flags;			/* Bits above */
+    int npcs;			/* Number of threads */
+    int *pcs;			/* Their positions, in increasing order */
+    char matched[0400];		/* Nonzero if a thread succeeds before char */
+    struct dfa_state *next[0400]; /* State after char, or zero if not made */
+  };
+
+struct re_automaton
+  {
+    int usable;			/* Zero if the pattern needs backtracking */
+    int used;			/* Length of the pattern */
+    unsigned char *kind;	/* For each position, the command there,
+				   AUTOMATON_LITERAL or AUTOMATON_ARG */
+    int context;		/* Bits above that the pattern looks at */
+    int syntax;			/* Nonzero if it uses the syntax table */
+    char syntax_codes[0400];	/* Syntax codes the DFA states assume */
+    char *literal;		/* A string that every match contains, or zero */
+    int literal_len;
+    int literal_max;		/* Most characters a match can have before it,
+				   or -1 if there is no limit */
+    int literal_shift_fwd[0400]; /* Boyer-Moore-Horspool shifts for finding it,
+				   keyed by its last character */
+    int literal_shift_bwd[0400]; /* and for finding it backward,
+				   keyed by its first character */
+    struct dfa_state *hash[DFA_HASH];
+    int nstates;
+    /* Work space, with room for each position of the pattern */
+    int generation;		/* Incremented for each new set of threads */
+    int *mark;			/* Generation each position was last seen in */
+    int *stack;
+    int *set;
+    int *pcs[2];		/* Lists of threads being simulated */
+    int *caps[2];		/* and their registers, NCAPS for each */
+  };
+
+/* The text being matched, as described for re_match_2 */
+
+struct automaton_text
+  {
+    char *string1, *string2;
+    int size1, total, mstop;
+  };
+
+#define TEXT_CHAR(t, i) \
+  ((i) < (t)->size1 ? (t)->string1[i] & 0377 \
+   : (t)->string2[(i) - (t)->size1] & 0377)
+#define NEXT_CHAR(t, i) ((i) < (t)->total ? TEXT_CHAR (t, i) : END_OF_TEXT)
+
+static int
+set_automaton_text (t, string1, size1, string2, size2, mstop)
+     struct automaton_text *t;
+     char *string1, *string2;
+     int size1, size2, mstop;
+{
+  /* Don't allow the second string to be empty unless both are empty.  */
+  if (!size2)
+    {
+      string2 = string1;
+      size2 = size1;
+      string1 = 0;
+      size1 = 0;
+    }
+  t->string1 = string1;
+  t->string2 = string2;
+  t->size1 = size1;
+  t->total = size1 + size2;
+  t->mstop = mstop;
+}
+
+static int
+free_automaton_space (a)
+     register struct re_automaton *a;
+{
+  register int i;
+
+  if (a->kind) free (a->kind);
+  if (a->literal) free (a->literal);
+  if (a->mark) free (a->mark);
+  if (a->stack) free (a->stack);
+  if (a->set) free (a->set);
+  for (i = 0; i < 2; i++)
+    {
+      if (a->pcs[i]) free (a->pcs[i]);
+      if (a->caps[i]) free (a->caps[i]);
+    }
+  a->kind = 0;
+  a->literal = 0;
+  a->mark = a->stack = a->set = 0;
+  a->pcs[0] = a->pcs[1] = a->caps[0] = a->caps[1] = 0;
+}
+
+static int automaton_literal ();
+
+static struct re_automaton *make_automaton ();
+
+/* Return the automaton for the pattern in BUFP, making it if necessary,
+   or zero if the pattern must be matched by backtracking.  */
+
+static struct re_automaton *
+re_automaton (bufp)
+     struct re_pattern_buffer *bufp;
+{
+  register struct re_automaton *a = (struct re_automaton *) bufp->automaton;
+  int quit_was;
+
+  if (a)
+    return a->usable ? a : 0;
+  HOLD_QUIT (quit_was);
+  a = make_automaton (bufp);
+  RELEASE_QUIT (quit_was);
+  return a;
+}
+
+static struct re_automaton *
+make_automaton (bufp)
+     struct re_pattern_buffer *bufp;
+{
+  register struct re_automaton *a;
+  register char *b = bufp->buffer;
+  register int pc, i;
+  int len, n;
+
+  a = (struct re_automaton *) malloc (sizeof (struct re_automaton));
+  if (!a)
+    return 0;
+  bzero (a, sizeof (struct re_automaton));
+  bufp->automaton = (char *) a;
+  a->used = bufp->used;
+  n = a->used + 1;
+  if (!(a->kind = (unsigned char *) malloc (n)))
+    goto unusable;
+
+  for (pc = 0; pc < a->used; pc += len)
+    {
+      len = 1;
+      switch (b[pc])
+	{
+	case exactn:
+	case charset:
+	case charset_not:
+	  len = 2 + (b[pc + 1] & 0377);
+	  break;
+
+	case jump:
+	case on_failure_jump:
+	case finalize_jump:
+	case maybe_finalize_jump:
+	case dummy_failure_jump:
+	  len = 3;
+	  break;
+
+	case start_memory:
+	case stop_memory:
+	  len = 2;
+	  break;
+
+	case syntaxspec:
+	case notsyntaxspec:
+	  len = 2;
+	case wordchar:
+	case notwordchar:
+	  a->syntax = 1;
+	  break;
+
+	case begline:
+	  a->context |= AT_START | AFTER_NEWLINE;
+	  break;
+
+	case begbuf:
+	  a->context |= AT_START;
+	  break;
+
+	case wordbeg:
+	case wordend:
+	case wordbound:
+	case notwordbound:
+	  a->context |= AT_START | AFTER_WORD;
+	  a->syntax = 1;
+	  break;
+
+	case endline:
+	case endbuf:
+	case anychar:
+	  break;
+
+	default:
+	  /* duplicate, which needs to know what a register matched,
+	     and the commands that test the position of point.  */
+	  goto unusable;
+	}
+      if (pc + len > a->used)
+	goto unusable;
+      a->kind[pc] = b[pc];
+      for (i = 1; i < len; i++)
+	a->kind[pc + i] = (b[pc] == exactn && i > 1
+			   ? AUTOMATON_LITERAL : AUTOMATON_ARG);
+    }
+  a->kind[a->used] = unused;
+
+  /* Each jump must go to a command or to the end of the pattern.  */
+  for (pc = 0; pc < a->used; pc++)
+    switch (a->kind[pc])
+      {
+      case jump:
+      case on_failure_jump:
+      case finalize_jump:
+      case maybe_finalize_jump:
+      case dummy_failure_jump:
+	i = JUMP_TARGET (b, pc);
+	if (i < 0 || i > a->used
+	    || a->kind[i] == AUTOMATON_LITERAL || a->kind[i] == AUTOMATON_ARG)
+	  goto unusable;
+      }
+
+  a->mark = (int *) malloc (n * sizeof (int));
+  a->stack = (int *) malloc ((2 * n + 4) * sizeof (int));
+  a->set = (int *) malloc (n * sizeof (int));
+  for (i = 0; i < 2; i++)
+    {
+      a->pcs[i] = (int *) malloc (n * sizeof (int));
+      a->caps[i] = (int *) malloc (n * NCAPS * sizeof (int));
+    }
+  if (!a->mark || !a->stack || !a->set || !a->pcs[0] || !a->pcs[1]
+      || !a->caps[0] || !a->caps[1])
+    goto unusable;
+  bzero (a->mark, n * sizeof (int));
+  automaton_literal (bufp, a);
+
+  if (a->syntax)
+    for (i = 0; i < 0400; i++)
+      a->syntax_codes[i] = (int) SYNTAX (i);
+  a->usable = 1;
+  return a;
+
+ unusable:
+  /* Keep the structure, so as not to look at this pattern again.  */
+  free_automaton_space (a);
+  return 0;
+}
+
+/* Discard all the DFA states of A except KEEP, if that is nonzero.
+   Return the state that replaces KEEP.  */
+
+static struct dfa_state *dfa_state ();
+
+static struct dfa_state *
+dfa_flush (a, keep)
+     register struct re_automaton *a;
+     struct dfa_state *keep;
+{
+  register struct dfa_state *s, *next;
+  register int i;
+  int npcs, flags, quit_was;
+
+  if (keep)
+    {
+      npcs = keep->npcs;
+      flags = keep->flags;
+      bcopy (keep->pcs, a->pcs[0], npcs * sizeof (int));
+    }
+  HOLD_QUIT (quit_was);
+  for (i = 0; i < DFA_HASH; i++)
+    {
+      for (s = a->hash[i]; s; s = next)
+	{
+	  next = s->hash_next;
+	  free (s);
+	}
+      a->hash[i] = 0;
+    }
+  a->nstates = 0;
+  s = keep ? dfa_state (a, a->pcs[0], npcs, flags) : 0;
+  RELEASE_QUIT (quit_was);
+  return s;
+}
+
+/* Free the automaton made for the pattern in BUFP, if any.  */
+
+re_free_automaton (bufp)
+     struct re_pattern_buffer *bufp;
+{
+  register struct re_automaton *a = (struct re_automaton *) bufp->automaton;
+
+  int quit_was;
+
+  if (!a)
+    return;
+  HOLD_QUIT (quit_was);
+  dfa_flush (a, 0);
+  free_automaton_space (a);
+  free (a);
+  bufp->automaton = 0;
+  RELEASE_QUIT (quit_was);
+}
+
+/* Start a new set of threads in A and return its generation number.  */
+
+static int
+automaton_generation (a)
+     register struct re_automaton *a;
+{
+  if (a->generation == 077777777)
+    {
+      bzero (a->mark, (a->used + 1) * sizeof (int));
+      a->generation = 0;
+    }
+  return ++a->generation;
+}
+
+/* If the syntax table has changed since A's DFA states were made,
+   discard them, and the fastmap of BUFP too.  */
+
+static int
+automaton_check_syntax (bufp, a)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+{
+  register int i;
+
+  for (i = 0; i < 0400; i++)
+    if (a->syntax_codes[i] != (char) SYNTAX (i))
+      break;
+  if (i == 0400)
+    return;
+  dfa_flush (a, 0);
+  bufp->fastmap_accurate = 0;
+  for (; i < 0400; i++)
+    a->syntax_codes[i] = (int) SYNTAX (i);
+}
+
+/* Return the bits of A's context that hold after character C.  */
+
+static int
+automaton_context (a, c)
+     register struct re_automaton *a;
+     register int c;
+{
+  register int flags = 0;
+
+  if (c == '\n')
+    flags |= AFTER_NEWLINE;
+  if (a->context & AFTER_WORD && SYNTAX (c) == Sword)
+    flags |= AFTER_WORD;
+  return flags & a->context;
+}
+
+static int
+text_context (a, t, pos)
+     struct re_automaton *a;
+     struct automaton_text *t;
+     int pos;
+{
+  if (!pos)
+    return a->context & AT_START;
+  return automaton_context (a, TEXT_CHAR (t, pos - 1));
+}
+
+/* Nonzero if the test command OP succeeds before character C,
+   where what comes before is described by FLAGS.  */
+
+static int
+automaton_test (op, flags, c)
+     int op, flags;
+     register int c;
+{
+  switch (op)
+    {
+    case begline:
+      return flags & (AT_START | AFTER_NEWLINE);
+
+    case endline:
+      return c == END_OF_TEXT || c == '\n';
+
+    case begbuf:
+      return flags & AT_START;
+
+    case endbuf:
+      return c == END_OF_TEXT;
+
+    case wordbound:
+      if (flags & AT_START || c == END_OF_TEXT)
+	return 1;
+      return !(flags & AFTER_WORD) != !(SYNTAX (c) == Sword);
+
+    case notwordbound:
+      if (flags & AT_START || c == END_OF_TEXT)
+	return 0;
+      return !(flags & AFTER_WORD) == !(SYNTAX (c) == Sword);
+
+    case wordbeg:
+      if (c == END_OF_TEXT || SYNTAX (c) != Sword)
+	return 0;
+      return flags & AT_START || !(flags & AFTER_WORD);
+
+    case wordend:
+      if (flags & AT_START || !(flags & AFTER_WORD))
+	return 0;
+      return c == END_OF_TEXT || SYNTAX (c) != Sword;
+    }
+  return 0;
+}
+
+/* Match character C with the thread at PC.
+   Return the thread's new position, or -1 if it fails.  */
+
+static int
+automaton_step (bufp, a, pc, c)
+     struct re_pattern_buffer *bufp;
+     struct re_automaton *a;
+     register int pc, c;
+{
+  register char *p = bufp->buffer + pc;
+  register int tc = bufp->translate ? bufp->translate[c] & 0377 : c;
+  int in;
+
+  switch (a->kind[pc])
+    {
+    case AUTOMATON_LITERAL:
+      return tc == (*p & 0377) ? pc + 1 : -1;
+
+    case anychar:
+      return tc == '\n' ? -1 : pc + 1;
+
+    case charset:
+    case charset_not:
+      in = (tc < (p[1] & 0377) * BYTEWIDTH
+	    && p[2 + tc / BYTEWIDTH] & (1 << (tc % BYTEWIDTH)));
+      if (in == (a->kind[pc] == charset_not))
+	return -1;
+      return pc + 2 + (p[1] & 0377);
+
+    case wordchar:
+      return SYNTAX (c) == Sword ? pc + 1 : -1;
+
+    case notwordchar:
+      return SYNTAX (c) != Sword ? pc + 1 : -1;
+
+    case syntaxspec:
+      return SYNTAX (c) == p[1] ? pc + 2 : -1;
+
+    case notsyntaxspec:
+      return SYNTAX (c) != p[1] ? pc + 2 : -1;
+    }
+  return -1;
+}
+
+/* Store in SUCC the positions that can follow position PC in A's
+   pattern, and return how many there are.  */
+
+static int
+automaton_successors (bufp, a, pc, succ)
+     struct re_pattern_buffer *bufp;
+     struct re_automaton *a;
+     register int pc;
+     register int *succ;
+{
+  register char *b = bufp->buffer;
+
+  switch (a->kind[pc])
+    {
+    case unused:
+      /* The end of the pattern */
+      return 0;
+
+    case exactn:
+    case start_memory:
+    case stop_memory:
+    case syntaxspec:
+    case notsyntaxspec:
+      succ[0] = pc + 2;
+      return 1;
+
+    case charset:
+    case charset_not:
+      succ[0] = pc + 2 + (b[pc + 1] & 0377);
+      return 1;
+
+    case on_failure_jump:
+      succ[0] = pc + 3;
+      succ[1] = JUMP_TARGET (b, pc);
+      return 2;
+
+    case jump:
+    case finalize_jump:
+    case maybe_finalize_jump:
+    case dummy_failure_jump:
+      succ[0] = JUMP_TARGET (b, pc);
+      return 1;
+    }
+  succ[0] = pc + 1;
+  return 1;
+}
+
+/* Nonzero if the command of kind KIND matches a character.  */
+
+static int
+automaton_consumes (kind)
+     int kind;
+{
+  switch (kind)
+    {
+    case AUTOMATON_LITERAL:
+    case anychar:
+    case charset:
+    case charset_not:
+    case wordchar:
+    case notwordchar:
+    case syntaxspec:
+    case notsyntaxspec:
+      return 1;
+    }
+  return 0;
+}
+
+/* Find the longest string that every match of the pattern in BUFP
+   contains, and how far into a match it can start, so that a search
+   can look for the string before running the automaton A.
+
+   Only an exactn that every way through the pattern passes qualifies,
+   together with the exactns that must come right after it.  Tests
+   like \b are assumed to succeed, which can only make fewer exactns
+   qualify.  The distance is bounded if no jump back is reachable
+   before the exactn; it is the longest path to it.  */
+
+static int
+automaton_literal (bufp, a)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+{
+  register char *b = bufp->buffer;
+  register int pc, i;
+  int *stack = a->stack, *dist = a->set;
+  int succ[2], nsucc, sp, gen, e, q, w, len, max, backward;
+  int tries = 0, best_len = 0, best_max = -1;
+  char *lit, *best;
+
+  lit = (char *) malloc (2 * a->used + 2);
+  if (!lit)
+    return;
+  best = lit + a->used + 1;
+
+  for (e = 0; e < a->used && tries < LITERAL_CANDIDATES; e++)
+    {
+      if (a->kind[e] != exactn)
+	continue;
+      tries++;
+
+      /* Find what is reachable from the start without passing E.  */
+      gen = automaton_generation (a);
+      backward = 0;
+      sp = 0;
+      a->mark[0] = gen;
+      stack[sp++] = 0;
+      while (sp)
+	{
+	  pc = stack[--sp];
+	  if (pc == e)
+	    continue;
+	  nsucc = automaton_successors (bufp, a, pc, succ);
+	  for (i = 0; i < nsucc; i++)
+	    {
+	      if (succ[i] <= pc)
+		backward = 1;
+	      if (a->mark[succ[i]] != gen)
+		{
+		  a->mark[succ[i]] = gen;
+		  stack[sp++] = succ[i];
+		}
+	    }
+	}
+      if (a->mark[e] != gen || a->mark[a->used] == gen)
+	continue;
+
+      max = -1;
+      if (!backward)
+	{
+	  /* Everything reachable goes forward, so the longest path to E
+	     can be found in one pass in order of position.  */
+	  for (pc = 0; pc <= e; pc++)
+	    dist[pc] = -1;
+	  dist[0] = 0;
+	  for (pc = 0; pc < e; pc++)
+	    {
+	      if (a->mark[pc] != gen || dist[pc] < 0)
+		continue;
+	      w = dist[pc] + automaton_consumes (a->kind[pc]);
+	      nsucc = automaton_successors (bufp, a, pc, succ);
+	      for (i = 0; i < nsucc; i++)
+		if (succ[i] <= e && dist[succ[i]] < w)
+		  dist[succ[i]] = w;
+	    }
+	  max = dist[e];
+	}
+
+      len = 0;
+      for (q = e; a->kind[q] == exactn;)
+	{
+	  bcopy (b + q + 2, lit + len, b[q + 1] & 0377);
+	  len += b[q + 1] & 0377;
+	  q += 2 + (b[q + 1] & 0377);
+	  while (a->kind[q] == start_memory || a->kind[q] == stop_memory)
+	    q += 2;
+	}
+      if (len > best_len
+	  || (len == best_len && max >= 0 && (best_max < 0 || max < best_max)))
+	{
+	  bcopy (lit, best, len);
+	  best_len = len;
+	  best_max = max;
+	}
+    }
+
+  /* A single character is no better than the fastmap.  */
+  if (best_len >= 2 && (a->literal = (char *) malloc (best_len)))
+    {
+      bcopy (best, a->literal, best_len);
+      a->literal_len = best_len;
+      a->literal_max = best_max;
+      for (i = 0; i < 0400; i++)
+	a->literal_shift_fwd[i] = a->literal_shift_bwd[i] = best_len;
+      for (i = 0; i < best_len - 1; i++)
+	a->literal_shift_fwd[best[i] & 0377] = best_len - 1 - i;
+      for (i = best_len - 1; i > 0; i--)
+	a->literal_shift_bwd[best[i] & 0377] = i;
+    }
+  free (lit);
+}
+
+/* Return the first position from FROM through TO where text T has
+   A's literal, or -1 if there is none.  */
+
+static int
+automaton_find_literal (a, t, translate, from, to)
+     register struct re_automaton *a;
+     register struct automaton_text *t;
+     char *translate;
+     int from, to;
+{
+  register char *lit = a->literal;
+  register int len = a->literal_len;
+  register int i, j, k, c;
+
+  for (i = from + len - 1; i < to + len; i += a->literal_shift_fwd[c])
+    {
+      c = TEXT_CHAR (t, i);
+      if (translate)
+	c = translate[c] & 0377;
+      if (c != (lit[len - 1] & 0377))
+	continue;
+      for (j = len - 2, k = i - 1; j >= 0; j--, k--)
+	if ((translate ? translate[TEXT_CHAR (t, k)] & 0377 : TEXT_CHAR (t, k))
+	    != (lit[j] & 0377))
+	  break;
+      if (j < 0)
+	return i - len + 1;
+    }
+  return -1;
+}
+
+/* Return the last position from TO back through FROM where text T has
+   A's literal, or -1 if there is none.  */
+
+static int
+automaton_find_literal_back (a, t, translate, from, to)
+     register struct re_automaton *a;
+     register struct automaton_text *t;
+     char *translate;
+     int from, to;
+{
+  register char *lit = a->literal;
+  register int len = a->literal_len;
+  register int i, j, c;
+
+  for (i = to; i >= from; i -= a->literal_shift_bwd[c])
+    {
+      c = TEXT_CHAR (t, i);
+      if (translate)
+	c = translate[c] & 0377;
+      if (c != (lit[0] & 0377))
+	continue;
+      for (j = 1; j < len; j++)
+	if ((translate ? translate[TEXT_CHAR (t, i + j)] & 0377
+	     : TEXT_CHAR (t, i + j))
+	    != (lit[j] & 0377))
+	  break;
+      if (j == len)
+	return i;
+    }
+  return -1;
+}
+
+/* Put in A->set the threads that the threads at PCS (NPCS of them)
+   become before character C, where what comes before is described
+   by FLAGS.  If FLAGS has SEARCHING, a new thread starts there too.
+   Those are the threads at commands that match a character.
+   Store their number in *NSET.
+   Return nonzero if a thread reaches the end of the pattern.  */
+
+static int
+dfa_closure (bufp, a, pcs, npcs, flags, c, nset)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     int *pcs;
+     int npcs, flags, c;
+     int *nset;
+{
+  register char *b = bufp->buffer;
+  register int *stack = a->stack;
+  register int sp = 0, pc;
+  int gen = automaton_generation (a);
+  int n = 0, matched = 0;
+
+  if (flags & SEARCHING)
+    stack[sp++] = 0;
+  while (npcs > 0)
+    stack[sp++] = pcs[--npcs];
+
+  while (sp)
+    {
+      pc = stack[--sp];
+      while (a->mark[pc] != gen)
+	{
+	  a->mark[pc] = gen;
+	  if (pc == a->used)
+	    {
+	      matched = 1;
+	      break;
+	    }
+	  switch (a->kind[pc])
+	    {
+	    case exactn:
+	    case start_memory:
+	    case stop_memory:
+	      pc += 2;
+	      continue;
+
+	    case on_failure_jump:
+	      stack[sp++] = JUMP_TARGET (b, pc);
+	      pc += 3;
+	      continue;
+
+	    case jump:
+	    case finalize_jump:
+	    case maybe_finalize_jump:
+	    case dummy_failure_jump:
+	      pc = JUMP_TARGET (b, pc);
+	      continue;
+
+	    case begline:
+	    case endline:
+	    case begbuf:
+	    case endbuf:
+	    case wordbeg:
+	    case wordend:
+	    case wordbound:
+	    case notwordbound:
+	      if (!automaton_test (a->kind[pc], flags, c))
+		break;
+	      pc++;
+	      continue;
+
+	    default:
+	      a->set[n++] = pc;
+	    }
+	  break;
+	}
+    }
+  *nset = n;
+  return matched;
+}
+
+/* Return the DFA state of A for the threads at PCS (NPCS of them,
+   in increasing order), where what comes before is described by FLAGS.
+   Make it if there is none yet.
+   Return zero if there is no room for another state.  */
+
+static struct dfa_state *
+dfa_state (a, pcs, npcs, flags)
+     register struct re_automaton *a;
+     int *pcs;
+     int npcs, flags;
+{
+  register struct dfa_state *s;
+  register unsigned h = flags;
+  register int i;
+  int quit_was;
+
+  for (i = 0; i < npcs; i++)
+    h = h * 31 + pcs[i];
+  h %= DFA_HASH;
+  for (s = a->hash[h]; s; s = s->hash_next)
+    if (s->flags == flags && s->npcs == npcs
+	&& !bcmp (s->pcs, pcs, npcs * sizeof (int)))
+      return s;
+
+  if (a->nstates == DFA_STATES)
+    return 0;
+  HOLD_QUIT (quit_was);
+  s = (struct dfa_state *) malloc (sizeof (struct dfa_state)
+				   + npcs * sizeof (int));
+  if (s)
+    {
+      bzero (s, sizeof (struct dfa_state));
+      s->flags = flags;
+      s->npcs = npcs;
+      s->pcs = (int *) (s + 1);
+      bcopy (pcs, s->pcs, npcs * sizeof (int));
+      s->hash_next = a->hash[h];
+      a->hash[h] = s;
+      a->nstates++;
+    }
+  RELEASE_QUIT (quit_was);
+  return s;
+}
+
+/* Make the transition of DFA state S on character C, and return the
+   state it goes to, or zero if there is no room for another state.  */
+
+static struct dfa_state *
+dfa_next (bufp, a, s, c)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     struct dfa_state *s;
+     int c;
+{
+  register int *set = a->set;
+  register int i, j, pc, n;
+  int nset, gen, matched;
+  struct dfa_state *next;
+
+  matched = dfa_closure (bufp, a, s->pcs, s->npcs, s->flags, c, &nset);
+  gen = automaton_generation (a);
+  for (i = n = 0; i < nset; i++)
+    {
+      pc = automaton_step (bufp, a, set[i], c);
+      if (pc >= 0 && a->mark[pc] != gen)
+	{
+	  a->mark[pc] = gen;
+	  set[n++] = pc;
+	}
+    }
+  /* Sort the threads, so that each set has one state.  */
+  for (i = 1; i < n; i++)
+    {
+      pc = set[i];
+      for (j = i; j > 0 && set[j - 1] > pc; j--)
+	set[j] = set[j - 1];
+      set[j] = pc;
+    }
+
+  next = dfa_state (a, set, n, automaton_context (a, c) | s->flags & SEARCHING);
+  if (next)
+    {
+      s->next[c] = next;
+      s->matched[c] = matched;
+    }
+  return next;
+}
+
+/* Add to the thread list LIST, which has N threads with registers LCAPS,
+   the threads that a thread at PC with registers CAPS becomes at text
+   position POS, before character C, where what comes before is
+   described by FLAGS.  Add them in the order the backtracking matcher
+   would try them, and only those at positions not in the list yet.
+   Return the new number of threads.  CAPS is left unchanged.  */
+
+static int
+pike_add (bufp, a, list, lcaps, n, pc, caps, pos, flags, c)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     int *list, *lcaps;
+     int n;
+     register int pc;
+     int *caps;
+     int pos, flags, c;
+{
+  register char *b = bufp->buffer;
+  register int *stack = a->stack;
+  register int sp = 0;
+  int slot;
+
+  stack[sp++] = pc;
+  stack[sp++] = 0;
+  while (sp)
+    {
+      sp -= 2;
+      pc = stack[sp];
+      if (pc < 0)
+	{
+	  /* Undo a register change made on the way to threads since added */
+	  caps[-1 - pc] = stack[sp + 1];
+	  continue;
+	}
+      while (a->mark[pc] != a->generation)
+	{
+	  a->mark[pc] = a->generation;
+	  switch (a->kind[pc])
+	    {
+	    case exactn:
+	      pc += 2;
+	      continue;
+
+	    case start_memory:
+	    case stop_memory:
+	      slot = 2 * (b[pc + 1] & 0377) + (a->kind[pc] == stop_memory);
+	      stack[sp++] = -1 - slot;
+	      stack[sp++] = caps[slot];
+	      caps[slot] = pos;
+	      pc += 2;
+	      continue;
+
+	    case on_failure_jump:
+	      stack[sp++] = JUMP_TARGET (b, pc);
+	      stack[sp++] = 0;
+	      pc += 3;
+	      continue;
+
+	    case jump:
+	    case finalize_jump:
+	    case maybe_finalize_jump:
+	    case dummy_failure_jump:
+	      pc = JUMP_TARGET (b, pc);
+	      continue;
+
+	    case begline:
+	    case endline:
+	    case begbuf:
+	    case endbuf:
+	    case wordbeg:
+	    case wordend:
+	    case wordbound:
+	    case notwordbound:
+	      if (!automaton_test (a->kind[pc], flags, c))
+		break;
+	      pc++;
+	      continue;
+
+	    default:
+	      /* A command that matches a character, or the end of the pattern */
+	      list[n] = pc;
+	      bcopy (caps, lcaps + n * NCAPS, NCAPS * sizeof (int));
+	      n++;
+	    }
+	  break;
+	}
+    }
+  return n;
+}
+
+/* Simulate the threads of the pattern in BUFP over text T from
+   position FROM, starting a new thread at each position up to
+   LASTSTART until one succeeds.  Return the position where the match
+   found starts, or -1 if none, or -2 if re_step_limit runs out;
+   store where it ends in *ENDP, and its registers in REGS if that
+   is nonzero.  */
+
+static int
+pike_search (bufp, a, t, from, laststart, regs, endp)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     register struct automaton_text *t;
+     int from, laststart;
+     struct re_registers *regs;
+     int *endp;
+{
+  int *cpcs = a->pcs[0], *ccaps = a->caps[0];
+  int *npcs = a->pcs[1], *ncaps = a->caps[1];
+  int *tem;
+  int caps[NCAPS], best[NCAPS];
+  register int k, pc;
+  int cn, nn, c, flags, nextc;
+  int pos = from, matched = 0;
+
+  automaton_generation (a);
+  for (k = 0; k < NCAPS; k++)
+    caps[k] = -1;
+  caps[0] = pos;
+  cn = pike_add (bufp, a, cpcs, ccaps, 0, 0, caps, pos,
+		 text_context (a, t, pos), NEXT_CHAR (t, pos));
+
+  while (1)
+    {
+      STEPS (cn);
+      if (pos < t->mstop)
+	{
+	  c = TEXT_CHAR (t, pos);
+	  flags = automaton_context (a, c);
+	  nextc = NEXT_CHAR (t, pos + 1);
+	}
+      automaton_generation (a);
+      nn = 0;
+      for (k = 0; k < cn; k++)
+	{
+	  pc = cpcs[k];
+	  if (pc == a->used)
+	    {
+	      /* This thread has succeeded.  The ones after it
+		 would be tried only if it had failed.  */
+	      bcopy (ccaps + k * NCAPS, best, sizeof best);
+	      best[1] = pos;
+	      matched = 1;
+	      break;
+	    }
+	  if (pos == t->mstop)
+	    continue;
+	  pc = automaton_step (bufp, a, pc, c);
+	  if (pc >= 0)
+	    {
+	      bcopy (ccaps + k * NCAPS, caps, sizeof caps);
+	      nn = pike_add (bufp, a, npcs, ncaps, nn, pc, caps, pos + 1,
+			     flags, nextc);
+	    }
+	}
+      if (pos == t->mstop)
+	break;
+      if (!matched && pos < laststart)
+	{
+	  for (k = 0; k < NCAPS; k++)
+	    caps[k] = -1;
+	  caps[0] = pos + 1;
+	  nn = pike_add (bufp, a, npcs, ncaps, nn, 0, caps, pos + 1,
+			 flags, nextc);
+	}
+      if (!nn && (matched || pos >= laststart))
+	break;
+      tem = cpcs, cpcs = npcs, npcs = tem;
+      tem = ccaps, ccaps = ncaps, ncaps = tem;
+      cn = nn;
+      pos++;
+    }
+
+  if (!matched)
+    return -1;
+  if (regs)
+    {
+      bzero (regs, sizeof (*regs));
+      /* A \( ... \)? that matched nothing has passed only the \(;
+	 report it as not matched at all.  */
+      for (k = 0; k < RE_NREGS; k++)
+	if (!k || best[2 * k] >= 0 && best[2 * k + 1] >= 0)
+	  {
+	    regs->start[k] = best[2 * k];
+	    regs->end[k] = best[2 * k + 1];
+	  }
+    }
+  *endp = best[1];
+  return best[0];
+}
+
+/* re_search_2 with the automaton A, for a RANGE that is not negative.  */
+
+static int
+automaton_search (bufp, a, string1, size1, string2, size2, startpos, range, regs, mstop)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     char *string1, *string2;
+     int size1, size2, startpos, range;
+     struct re_registers *regs;
+     int mstop;
+{
+  struct automaton_text text;
+  register struct automaton_text *t = &text;
+  register struct dfa_state *s, *next;
+  register int pos, c;
+  char *fastmap = bufp->fastmap;
+  char *translate = bufp->translate;
+  int laststart, from, flags, end, flushes = 0, hit = -1;
+
+  set_automaton_text (t, string1, size1, string2, size2, mstop);
+  laststart = startpos + range;
+  if (laststart > t->mstop)
+    laststart = t->mstop;
+  if (startpos > laststart)
+    return -1;
+  if (a->syntax)
+    automaton_check_syntax (bufp, a);
+  if (fastmap && !bufp->fastmap_accurate)
+    re_compile_fastmap (bufp);
+  if (bufp->can_be_null)
+    fastmap = 0;
+
+  pos = from = startpos;
+  s = 0;
+
+  while (1)
+    {
+      if (!s || !s->npcs)
+	{
+	  /* No thread started before here is still alive.  */
+	  if (s && !(s->flags & SEARCHING))
+	    return -1;
+	  c = pos;
+	  /* A match contains the literal, if any, no farther into it
+	     than literal_max.  */
+	  if (a->literal)
+	    {
+	      if (hit < pos
+		  && (hit = automaton_find_literal (a, t, translate, pos,
+						    t->mstop - a->literal_len)) < 0)
+		return -1;
+	      if (a->literal_max >= 0 && hit - a->literal_max > pos)
+		pos = hit - a->literal_max;
+	    }
+	  /* Skip what cannot start a match, as re_search_2 would.  */
+	  if (fastmap)
+	    while (pos < t->mstop && pos <= laststart
+		   && !fastmap[translate ? translate[TEXT_CHAR (t, pos)] & 0377
+			       : TEXT_CHAR (t, pos)])
+	      pos++;
+	  if (pos > laststart || fastmap && pos == t->mstop)
+	    return -1;
+	  if (pos != c)
+	    s = 0;
+	  from = pos;
+	  re_statistics.positions++;
+	  if (!s)
+	    {
+	      flags = text_context (a, t, pos) | SEARCHING;
+	      if (!(s = dfa_state (a, a->set, 0, flags)))
+		{
+		  dfa_flush (a, 0);
+		  if (!(s = dfa_state (a, a->set, 0, flags)))
+		    goto simulate;
+		}
+	    }
+	}
+      if (pos == t->mstop)
+	{
+	  if (!dfa_closure (bufp, a, s->pcs, s->npcs, s->flags,
+			    NEXT_CHAR (t, pos), &end))
+	    return -1;
+	  break;
+	}
+      STEPS (1);
+      c = TEXT_CHAR (t, pos);
+      if (!(next = s->next[c])
+	  && !(next = dfa_next (bufp, a, s, c)))
+	{
+	  /* No room for another state: start over with just this one.  */
+	  if (++flushes > DFA_FLUSHES
+	      || !(s = dfa_flush (a, s))
+	      || !(next = dfa_next (bufp, a, s, c)))
+	    goto simulate;
+	}
+      if (s->matched[c])
+	break;
+      if (pos == laststart)
+	{
+	  /* Threads stop starting after here.  */
+	  flags = next->flags & ~SEARCHING;
+	  if (!(s = dfa_state (a, next->pcs, next->npcs, flags))
+	      && (!(next = dfa_flush (a, next))
+		  || !(s = dfa_state (a, next->pcs, next->npcs, flags))))
+	    goto simulate;
+	  next = s;
+	}
+      s = next;
+      pos++;
+    }
+
+  /* A match ends where the DFA stopped, and none can start before FROM.
+     Find the one the backtracking matcher would.  */
+ simulate:
+  return pike_search (bufp, a, t, from, laststart, regs, &end);
+}
+
+/* 1 if a match of the pattern in BUFP starts at position FROM
+   of text T, 0 if not, or -2 if re_step_limit runs out first.
+   The DFA of A is run without starting new threads,
+   so this costs no more than the characters such a match looks at.  */
+
+static int
+automaton_anchored (bufp, a, t, from)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     register struct automaton_text *t;
+     int from;
+{
+  register struct dfa_state *s, *next;
+  register int pos = from, c;
+  int start = 0, flags, end, flushes = 0;
+
+  re_statistics.positions++;
+  flags = text_context (a, t, pos);
+  if (!(s = dfa_state (a, &start, 1, flags)))
+    {
+      dfa_flush (a, 0);
+      if (!(s = dfa_state (a, &start, 1, flags)))
+	goto simulate;
+    }
+
+  while (s->npcs)
+    {
+      if (pos == t->mstop)
+	return dfa_closure (bufp, a, s->pcs, s->npcs, s->flags,
+			    NEXT_CHAR (t, pos), &end);
+      STEPS (1);
+      c = TEXT_CHAR (t, pos);
+      if (!(next = s->next[c])
+	  && !(next = dfa_next (bufp, a, s, c)))
+	{
+	  if (++flushes > DFA_FLUSHES
+	      || !(s = dfa_flush (a, s))
+	      || !(next = dfa_next (bufp, a, s, c)))
+	    goto simulate;
+	}
+      if (s->matched[c])
+	return 1;
+      s = next;
+      pos++;
+    }
+  return 0;
+
+ simulate:
+  pos = pike_search (bufp, a, t, from, from, 0, &end);
+  return pos == -2 ? -2 : pos >= 0;
+}
+
+/* re_search_2 with the automaton A, for a negative RANGE.
+   The starting positions are tried from the last one back, as
+   re_search_2 would, but positions that cannot start a match
+   are passed over using the fastmap and A's literal, and each
+   remaining one is tried without backtracking.  */
+
+static int
+automaton_search_back (bufp, a, string1, size1, string2, size2, startpos, range, regs, mstop)
+     struct re_pattern_buffer *bufp;
+     register struct re_automaton *a;
+     char *string1, *string2;
+     int size1, size2, startpos, range;
+     struct re_registers *regs;
+     int mstop;
+{
+  struct automaton_text text;
+  register struct automaton_text *t = &text;
+  register int pos;
+  char *fastmap = bufp->fastmap;
+  char *translate = bufp->translate;
+  int firststart, to, hit, end;
+
+  set_automaton_text (t, string1, size1, string2, size2, mstop);
+  firststart = startpos + range;
+  pos = startpos;
+  if (pos > t->mstop)
+    pos = t->mstop;
+  if (a->syntax)
+    automaton_check_syntax (bufp, a);
+  if (fastmap && !bufp->fastmap_accurate)
+    re_compile_fastmap (bufp);
+  if (bufp->can_be_null)
+    fastmap = 0;
+
+  /* HIT is the last place the literal is at or before TO,
+     once it has been looked for.  TO only gets smaller.  */
+  hit = t->mstop + 1;
+
+  while (pos >= firststart)
+    {
+      /* A match starting at POS contains the literal at or after POS,
+	 and no farther into it than literal_max.  */
+      if (a->literal)
+	{
+	  to = t->mstop - a->literal_len;
+	  if (a->literal_max >= 0 && pos + a->literal_max < to)
+	    to = pos + a->literal_max;
+	  if (hit > to
+	      && (hit = automaton_find_literal_back (a, t, translate,
+						     firststart, to)) < 0)
+	    return -1;
+	  if (hit < pos)
+	    pos = hit;
+	}
+      /* Skip what cannot start a match, as re_search_2 would.  */
+      if (fastmap && pos < t->mstop)
+	{
+	  while (pos >= firststart
+		 && !fastmap[translate ? translate[TEXT_CHAR (t, pos)] & 0377
+			     : TEXT_CHAR (t, pos)])
+	    pos--;
+	  if (pos < firststart)
+	    return -1;
+	}
+      switch (automaton_anchored (bufp, a, t, pos))
+	{
+	case -2:
+	  return -2;
+	case 1:
+	  if (regs && pike_search (bufp, a, t, pos, pos, regs, &end) == -2)
+	    return -2;
+	  return pos;
+	}
+      pos--;
+    }
+  return -1;
+}
+
+/* re_match_2 with the automaton A.  */
+
+static int
+automaton_match (bufp, a, string1, size1, string2, size2, pos, regs, mstop)
+     struct re_pattern_buffer *bufp;
+     struct re_automaton *a;
+     char *string1, *string2;
+     int size1, size2, pos;
+     struct re_registers *regs;
+     int mstop;
+{
+  struct automaton_text text;
+  int end, val;
+
+  set_automaton_text (&text, string1, size1, string2, size2, mstop);
+  if (pos > text.mstop)
+    return -1;
+  re_statistics.positions++;
+  val = pike_search (bufp, a, &text, pos, pos, regs, &end);
+  if (val < 0)
+    return val;
+  return end - pos;
+}
+
 static int
 bcmp_translate (s1, s2, len, translate)
      char *s1, *s2;
@@ -1521,6 +2964,7 @@ main ()
   buf.buffer = (char *) malloc (buf.allocated);
   buf.fastmap = fastmap;
   buf.translate = upcase;
+  buf.automaton = 0;
 
   while (1)
     {
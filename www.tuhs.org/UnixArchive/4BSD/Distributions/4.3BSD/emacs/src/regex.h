@@ -73,6 +73,9 @@ struct re_pattern_buffer
 			   if this pattern might match the null string.
 			   It does not necessarily match the null string
 			   in that case, but if this is zero, it cannot.  */
+    char *automaton;	/* Data for matching the pattern as an automaton,
+			   made when first needed, or zero.
+			   Must be zero before the first pattern is stored.  */
   };
 
 /* Structure to store "register" contents data in.
@@ -90,4 +93,26 @@ struct re_registers
     int end[RE_NREGS];
   };
 
+/* What matching has cost since the caller last cleared this.
+   re_search_2 and re_match_2 add to it.  */
+
+struct re_statistics
+  {
+    int positions;	/* Number of starting positions tried.
+			   An automaton tries a run of positions at once
+			   and counts it as one. */
+    int steps;		/* Number of pattern commands executed, or for an
+			   automaton, of characters stepped over by each
+			   thread still alive. */
+    int backtracks;	/* Number of times a failure point was resumed */
+    int max_failures;	/* Most failure points on the stack at once */
+  };
+
+extern struct re_statistics re_statistics;
+
+/* If this is positive, re_search_2 and re_match_2 give up and return -2
+   once re_statistics.steps exceeds it.  */
+
+extern int re_step_limit;
+
 char *re_compile_pattern ();
@@ -29,57 +29,139 @@ and this notice must be preserved on all copies.  */
 
 unsigned char downcase_table[0400] = {0};	/* folds upper to lower case */
 
-/* We compile regexps into this buffer and then use it for searching. */
+/* Compiled regexps are kept in a cache, most recently used first,
+   so that code alternating among a few regexps does not recompile them.
+   Entries are keyed by the contents of the regexp and by the translate
+   table, and each has its own fastmap, which stays valid with it.  */
 
-static struct re_pattern_buffer searchbuf;
+struct regexp_cache
+  {
+    struct regexp_cache *next;
+    char *pattern;		/* Copy of the regexp */
+    int size;			/* Its length, or -1 if entry is not valid */
+    int space;			/* Space allocated for the copy */
+    struct re_pattern_buffer buf;
+    char fastmap[0400];
+  };
 
-char search_fastmap[0400];
+static struct regexp_cache *regexp_cache;
 
-/* Last regexp we compiled */
+/* Maximum number of compiled regexps kept.  */
+int regexp_cache_size;
 
-Lisp_Object last_regexp;
+/* Number of lookups that found or did not find a compiled regexp.  */
+int regexp_cache_hits, regexp_cache_misses;
 
 /* Every call to re_match, etc., must pass &search_regs as the regs argument
  unless you can show it is unnecessary (i.e., if re_match is certainly going
- to be called again before region-around-match can be called).  */
+ to be called again before region-around-match can be called).
+ Each thread has its own; see thread.c.  */
 
-static struct re_registers search_regs;
+struct re_registers search_regs;
 
 /* error condition signalled when regexp compile_pattern fails */
 
 Lisp_Object Qinvalid_regexp;
 
-/* Compile a regexp and signal a Lisp error if anything goes wrong.  */
+/* Compile a regexp and signal a Lisp error if anything goes wrong.
+   Return the compiled pattern, which stays valid until the next call.
+   Every regexp search starts here, so this also clears the statistics
+   of the previous one.  */
 
-compile_pattern (pattern, bufp, translate)
+struct re_pattern_buffer *
+compile_pattern (pattern, translate)
      Lisp_Object pattern;
-     struct re_pattern_buffer *bufp;
      char *translate;
 {
+  register struct regexp_cache *c, **cp;
+  struct regexp_cache *tem;
+  register int size = XSTRING (pattern)->size;
+  register int i, limit;
   char *val;
   Lisp_Object dummy;
 
-  if (EQ (pattern, last_regexp)
-      && translate == bufp->translate)
-    return;
-  last_regexp = Qnil;
-  bufp->translate = translate;
-  val = re_compile_pattern (XSTRING (pattern)->data,
-			    XSTRING (pattern)->size,
-			    bufp);
+  bzero (&re_statistics, sizeof re_statistics);
+
+  for (cp = &regexp_cache; c = *cp; cp = &c->next)
+    if (c->size == size && c->buf.translate == translate
+	&& !bcmp (c->pattern, XSTRING (pattern)->data, size))
+      {
+	*cp = c->next;
+	c->next = regexp_cache;
+	regexp_cache = c;
+	regexp_cache_hits++;
+	return &c->buf;
+      }
+  regexp_cache_misses++;
+
+  /* Detach the entries beyond the size limit, to reuse one of them
+     and free the rest; the limit may have been lowered.  */
+  limit = regexp_cache_size > 1 ? regexp_cache_size : 1;
+  c = 0;
+  for (i = 1, cp = &regexp_cache; *cp; i++)
+    if (i < limit)
+      cp = &(*cp)->next;
+    else
+      {
+	tem = *cp;
+	*cp = tem->next;
+	if (c)
+	  {
+	    re_free_automaton (&tem->buf);
+	    free (tem->buf.buffer);
+	    free (tem->pattern);
+	    free (tem);
+	  }
+	else
+	  c = tem;
+      }
+  if (!c)
+    {
+      c = (struct regexp_cache *) xmalloc (sizeof (struct regexp_cache));
+      c->buf.allocated = 100;
+      c->buf.buffer = (char *) xmalloc (c->buf.allocated);
+      c->buf.fastmap = c->fastmap;
+      c->buf.automaton = 0;
+      c->space = 20;
+      c->pattern = (char *) xmalloc (c->space);
+    }
+  c->next = regexp_cache;
+  regexp_cache = c;
+
+  c->size = -1;
+  c->buf.translate = translate;
+  val = re_compile_pattern (XSTRING (pattern)->data, size, &c->buf);
   if (val)
     {
       dummy = build_string (val);
       while (1)
 	Fsignal (Qinvalid_regexp, Fcons (dummy, Qnil));
     }
-  last_regexp = pattern;
-  return;
+
+  if (size > c->space)
+    {
+      c->space = size + 20;
+      c->pattern = (char *) xrealloc (c->pattern, c->space);
+    }
+  bcopy (XSTRING (pattern)->data, c->pattern, size);
+  c->size = size;
+  return &c->buf;
 }
 
 /* Error condition used for failing searches */
 Lisp_Object Qsearch_failed;
 
+/* error condition signalled when a regexp search runs past regexp-step-limit */
+
+Lisp_Object Qregexp_limit_exceeded;
+
+regexp_limit_exceeded (regexp)
+     Lisp_Object regexp;
+{
+  while (1)
+    Fsignal (Qregexp_limit_exceeded, Fcons (regexp, Qnil));
+}
+
 Lisp_Object
 signal_failure (arg)
      Lisp_Object arg;
@@ -93,14 +175,15 @@ DEFUN ("looking-at", Flooking_at, Slooking_at, 1, 1, 0,
   (string)
      Lisp_Object string;
 {
-  Lisp_Object val;
+  int val;
   unsigned char *p1, *p2;
   int s1, s2;
   register int i;
+  struct re_pattern_buffer *bufp;
 
   CHECK_STRING (string, 0);
-  compile_pattern (string, &searchbuf,
-		   !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
+  bufp = compile_pattern (string,
+			  !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
 
   immediate_quit = 1;
   QUIT;			/* Do a pending quit right away, to avoid paradoxical behavior */
@@ -124,17 +207,18 @@ DEFUN ("looking-at", Flooking_at, Slooking_at, 1, 1, 0,
       s2 = 0;
     }
   
-  val = (0 <= re_match_2 (&searchbuf, p1, s1, p2, s2,
-			  point - FirstCharacter, &search_regs,
-			  NumCharacters + 1 - FirstCharacter)
-	 ? Qt : Qnil);
+  val = re_match_2 (bufp, p1, s1, p2, s2,
+		    point - FirstCharacter, &search_regs,
+		    NumCharacters + 1 - FirstCharacter);
+  if (val == -2)
+    regexp_limit_exceeded (string);
   for (i = 0; i < RE_NREGS; i++)
     {
       search_regs.start[i] += FirstCharacter - 1;
       search_regs.end[i] += FirstCharacter - 1;
     }
   immediate_quit = 0;
-  return val;
+  return val >= 0 ? Qt : Qnil;
 }
 
 DEFUN ("string-match", Fstring_match, Sstring_match, 2, 3, 0,
@@ -148,6 +232,7 @@ matched by parenthesis constructs in the pattern.")
 {
   int val;
   int s;
+  struct re_pattern_buffer *bufp;
 
   CHECK_STRING (regexp, 0);
   CHECK_STRING (string, 1);
@@ -160,10 +245,12 @@ matched by parenthesis constructs in the pattern.")
       s = XINT (start);
     }
 
-  compile_pattern (regexp, &searchbuf,
-		   !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
-  val = re_search (&searchbuf, XSTRING (string)->data, XSTRING (string)->size,
+  bufp = compile_pattern (regexp,
+			  !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
+  val = re_search (bufp, XSTRING (string)->data, XSTRING (string)->size,
 			       s, XSTRING (string)->size - s, &search_regs);
+  if (val == -2)
+    regexp_limit_exceeded (regexp);
   /* Correct for propensity of match-beginning and match-end
      to add 1 to each of these (which is correct for buffer positions
      since they are origin-1, but not for indices in strings).  */
@@ -191,27 +278,61 @@ Note that this does -not- take take  case-fold-search  into consideration.")
   return make_number (ScanBf (XINT (c), XINT (from), XINT (count)));
 }
 
+/* The text before the gap and the text after it are each contiguous,
+   so ScanBf and skip_chars scan each part with a pointer, rather than
+   testing which side of the gap every position is on with CharAt.
+   BUFFER_SEGMENT sets BASE and LIMIT so that BASE + POS addresses
+   character POS, and positions POS up to but not including LIMIT
+   are in the same part.  END is where the scan stops.  */
+
+#define BUFFER_SEGMENT(pos, end, base, limit) \
+  if ((pos) <= bf_s1) \
+    (base) = bf_p1, (limit) = (end) <= bf_s1 ? (end) : bf_s1 + 1; \
+  else \
+    (base) = bf_p2, (limit) = (end)
+
+/* Likewise, but for scanning backward from POS - 1 down to END.  */
+
+#define BUFFER_SEGMENT_BACK(pos, end, base, limit) \
+  if ((pos) - 1 > bf_s1) \
+    (base) = bf_p2, (limit) = (end) > bf_s1 ? (end) : bf_s1 + 1; \
+  else \
+    (base) = bf_p1, (limit) = (end)
+
 ScanBf (target, pos, cnt)
-     register int target, pos, cnt;
+     register int target;
+     int pos;
+     register int cnt;
 {
-  register int end;
+  register unsigned char *p, *stop;
+  unsigned char *base;
+  int end, limit;
+
   if (cnt > 0)
     {
       end = NumCharacters + 1;
       while (pos < end)
 	{
-	  if (CharAt (pos) == target && !--cnt)
-	    return pos + 1;
-	  pos++;
+	  BUFFER_SEGMENT (pos, end, base, limit);
+	  for (p = base + pos, stop = base + limit; p != stop; )
+	    if (*p++ == target && !--cnt)
+	      return p - base;
+	  pos = limit;
 	}
       return pos;
     }
   if (cnt < 0)
     {
       end = FirstCharacter;
-      do pos--;
-      while (pos >= end &&
-	     (CharAt (pos) != target || ++cnt));
+      while (pos > end)
+	{
+	  BUFFER_SEGMENT_BACK (pos, end, base, limit);
+	  for (p = base + pos, stop = base + limit; p != stop; )
+	    if (*--p == target && !++cnt)
+	      return p - base + 1;
+	  pos = limit;
+	}
+      return pos;
     }
   return pos + 1;
 }
@@ -248,6 +369,8 @@ skip_chars (forwardp, string, lim)
   unsigned char fastmap[0400];
   int negate = 0;
   register int i;
+  unsigned char *base;
+  int pos, limit;
 
   CHECK_STRING (string, 0);
 
@@ -296,16 +419,32 @@ skip_chars (forwardp, string, lim)
     for (i = 0; i < sizeof fastmap; i++)
       fastmap[i] ^= 1;
 
+  pos = point;
   if (forwardp)
     {
-      while (point < XINT (lim) && fastmap[CharAt (point)])
-	PointRight (1);
+      while (pos < XINT (lim))
+	{
+	  BUFFER_SEGMENT (pos, XINT (lim), base, limit);
+	  for (p = base + pos, pend = base + limit; p != pend && fastmap[*p]; p++)
+	    ;
+	  pos = p - base;
+	  if (p != pend)
+	    break;
+	}
     }
   else
     {
-      while (point > XINT (lim) && fastmap[CharAt (point - 1)])
-	PointLeft (1);
+      while (pos > XINT (lim))
+	{
+	  BUFFER_SEGMENT_BACK (pos, XINT (lim), base, limit);
+	  for (p = base + pos, pend = base + limit; p != pend && fastmap[p[-1]]; p--)
+	    ;
+	  pos = p - base;
+	  if (p != pend)
+	    break;
+	}
     }
+  SetPoint (pos);
 }
 
 /* Subroutines of Lisp buffer search functions. */
@@ -369,6 +508,8 @@ search_command (string, bound, noerror, count, direction, RE)
    or else the position at the beginning of the `n'th occurrence (if searching backward)
    or the end (if searching forward).  */
 
+static int literal_search_forward (), literal_search_backward ();
+
 search_buffer (string, from, lim, n, RE, trt)
      Lisp_Object string;
      int from;
@@ -382,7 +523,8 @@ search_buffer (string, from, lim, n, RE, trt)
   register int len = XSTRING (string)->size;
   register int i, j;
   unsigned char *p1, *p2;
-  int s1, s2;
+  int s1, s2, val;
+  struct re_pattern_buffer *bufp;
 
   immediate_quit = 1;	/* Quit immediately if user types ^G,
 			   because letting this function finish can take too long. */
@@ -390,7 +532,7 @@ search_buffer (string, from, lim, n, RE, trt)
 
   if (RE)
     {
-      compile_pattern (string, &searchbuf, (char *) trt);
+      bufp = compile_pattern (string, (char *) trt);
 
       /* Get pointers and sizes of the two strings
 	 that make up the visible portion of the buffer. */
@@ -417,22 +559,8 @@ search_buffer (string, from, lim, n, RE, trt)
       if (!RE)
 	{
           pos -= len;
-	  if (trt && !(trt == downcase_table && !isalpha (pat[0])))
-	    {
-	      j = trt[pat[0]];
-	      while (pos >= lim
-		     && (j != trt[CharAt (pos)]
-			 || bcmp_buffer_translated (pat, len, pos, trt)))
-		pos--;
-	    }
-	  else
-	    {
-	      j = pat[0];
-	      while (pos >= lim
-		     && (j != CharAt (pos)
-			 || bcmp_buffer_translated (pat, len, pos, trt)))
-		pos--;
-	    }
+	  if (pos >= lim)
+	    pos = literal_search_backward (pat, len, pos, lim, trt);
 
 	  if (pos < lim)
 	    {
@@ -444,11 +572,13 @@ search_buffer (string, from, lim, n, RE, trt)
 	}
       else
 	{
-	  if (re_search_2 (&searchbuf, p1, s1, p2, s2,
-			   pos - FirstCharacter, lim - pos, &search_regs,
-			   /* Don't allow match past current point */
-			   pos - FirstCharacter)
-	      >= 0)
+	  val = re_search_2 (bufp, p1, s1, p2, s2,
+			     pos - FirstCharacter, lim - pos, &search_regs,
+			     /* Don't allow match past current point */
+			     pos - FirstCharacter);
+	  if (val == -2)
+	    regexp_limit_exceeded (string);
+	  if (val >= 0)
 	    {
 	      j = FirstCharacter - 1;
 	      for (i = 0; i < RE_NREGS; i++)
@@ -473,22 +603,8 @@ search_buffer (string, from, lim, n, RE, trt)
       if (!RE)
 	{
 	  lim -= len;
-	  if (trt && !(trt == downcase_table && !isalpha (pat[0])))
-	    {
-	      j = trt[pat[0]];
-	      while (pos <= lim
-		     && (j != trt[CharAt (pos)]
-			 || bcmp_buffer_translated (pat, len, pos, trt)))
-		pos++;
-	    }
-	  else
-	    {
-	      j = pat[0];
-	      while (pos <= lim
-		     && (j != CharAt (pos)
-			 || bcmp_buffer_translated (pat, len, pos, trt)))
-		pos++;
-	    }
+	  if (pos <= lim)
+	    pos = literal_search_forward (pat, len, pos, lim, trt);
 
 	  if (pos > lim)
 	    {
@@ -504,10 +620,12 @@ search_buffer (string, from, lim, n, RE, trt)
 	}
       else
 	{
-	  if (re_search_2 (&searchbuf, p1, s1, p2, s2,
-			   pos - FirstCharacter, lim - pos, &search_regs,
-			   lim - FirstCharacter)
-	      >= 0)
+	  val = re_search_2 (bufp, p1, s1, p2, s2,
+			     pos - FirstCharacter, lim - pos, &search_regs,
+			     lim - FirstCharacter);
+	  if (val == -2)
+	    regexp_limit_exceeded (string);
+	  if (val >= 0)
 	    {
 	      j = FirstCharacter - 1;
 	      for (i = 0; i < RE_NREGS; i++)
@@ -529,6 +647,118 @@ search_buffer (string, from, lim, n, RE, trt)
   return pos;
 }
 
+/* Literal searches use the Boyer-Moore-Horspool method: the buffer
+  character aligned with one end of the pattern determines how far the
+  pattern can be moved without passing a match, so most characters of
+  the buffer are never looked at.  Characters are fetched with CharAt,
+  so the search works across the gap without moving it.
+
+  The shift tables depend only on the pattern as translated by the
+  translate table, so they are kept for the last pattern searched for
+  and reused while that is unchanged.  */
+
+static unsigned char *literal_pat;	/* Translated pattern */
+static int literal_pat_len;		/* Its length */
+static int literal_pat_size;		/* Space allocated for it */
+static int literal_shift_fwd[0400];	/* Shifts keyed by last char */
+static int literal_shift_bwd[0400];	/* Shifts keyed by first char */
+
+static unsigned char *
+literal_prepare (pat, len, trt)
+     unsigned char *pat;
+     register int len;
+     register unsigned char *trt;
+{
+  unsigned char *tpat;
+  register int i;
+
+  tpat = (unsigned char *) alloca (len);
+  for (i = 0; i < len; i++)
+    tpat[i] = trt ? trt[pat[i]] : pat[i];
+
+  if (literal_pat && len == literal_pat_len && !bcmp (tpat, literal_pat, len))
+    return literal_pat;
+
+  if (len > literal_pat_size)
+    {
+      literal_pat_size = len + 20;
+      if (literal_pat)
+	literal_pat = (unsigned char *) xrealloc (literal_pat, literal_pat_size);
+      else
+	literal_pat = (unsigned char *) xmalloc (literal_pat_size);
+    }
+  bcopy (tpat, literal_pat, len);
+  literal_pat_len = len;
+
+  for (i = 0; i < 0400; i++)
+    literal_shift_fwd[i] = literal_shift_bwd[i] = len;
+  for (i = 0; i < len - 1; i++)
+    literal_shift_fwd[literal_pat[i]] = len - 1 - i;
+  for (i = len - 1; i > 0; i--)
+    literal_shift_bwd[literal_pat[i]] = i;
+  return literal_pat;
+}
+
+/* Return the first position from `pos' through `lim' where the `len'
+  characters of `pat' occur, translated through `trt' if that is
+  nonzero, or `lim' + 1 if there is none.  */
+
+static int
+literal_search_forward (pat, len, pos, lim, trt)
+     unsigned char *pat;
+     int len;
+     register int pos, lim;
+     register unsigned char *trt;
+{
+  register unsigned char *tpat;
+  register int last, c;
+
+  if (len == 0)
+    return pos;
+  tpat = literal_prepare (pat, len, trt);
+  last = tpat[len - 1];
+  for (lim += len - 1, pos += len - 1; pos <= lim; pos += literal_shift_fwd[c])
+    {
+      c = CharAt (pos);
+      if (trt)
+	c = trt[c];
+      if (c == last
+	  && !bcmp_buffer_translated (pat, len, pos - (len - 1), trt))
+	return pos - (len - 1);
+    }
+  return lim - (len - 1) + 1;
+}
+
+/* Return the last position from `pos' back through `lim' where the
+  `len' characters of `pat' occur, translated through `trt' if that is
+  nonzero, or `lim' - 1 if there is none.  */
+
+static int
+literal_search_backward (pat, len, pos, lim, trt)
+     unsigned char *pat;
+     int len;
+     register int pos, lim;
+     register unsigned char *trt;
+{
+  register unsigned char *tpat;
+  register int first, c;
+
+  if (len == 0)
+    return pos;
+  tpat = literal_prepare (pat, len, trt);
+  first = tpat[0];
+  for (; pos >= lim; pos -= literal_shift_bwd[c])
+    {
+      c = CharAt (pos);
+      if (trt)
+	c = trt[c];
+      if (c == first
+	  && !bcmp_buffer_translated (pat, len, pos, trt))
+	return pos;
+    }
+  return lim - 1;
+}
+
 /* Return nonzero unless the `len' characters in the buffer starting at position `pos'
   match the `len' characters at `pat', with all characters going through the
   translate table `trt' if `trt' is nonzero.  */
@@ -722,6 +952,488 @@ See also the functions match-beginning and match-end and replace-match.")
   return search_command (string, bound, noerror, count, 1, 1);
 }
 
+/* Keyword matchers.  See struct Lisp_Keyword_Matcher in lisp.h.
+
+ The automaton is a trie of the words, with a node for each prefix of
+ a word.  Node 0 is the empty prefix.  The others are numbered breadth
+ first, so the edges to the children of each node are consecutive.
+ The tables string holds these ints, one group after another:
+
+   the number of nodes, the number of edges other than node 0's,
+     and the length of the longest word;
+   root[0400]		node 0's child for each character, or 0;
+   fail[nodes]		node for the longest proper suffix of the prefix
+			that is also a prefix in the trie;
+   out[nodes]		index of the word that ends at the node, or -1;
+   dict[nodes]		nearest node along the fail links at which
+			a word ends, or 0;
+   depth[nodes]		length of the prefix;
+   first[nodes + 1]	index of each node's first edge; its edges run
+			up to the next node's first;
+   edge_char[edges]	character of each edge, increasing for each node;
+   edge_to[edges]	node each edge goes to.
+
+ Scanning a character from a node follows fail links until a node has
+ an edge for it.  All the words that end at a node are found by taking
+ it, if a word ends there, and then following dict links.  */
+
+struct keyword_tables
+  {
+    int nodes, edges, maxlen;
+    int *root, *fail, *out, *dict, *depth, *first, *edge_char, *edge_to;
+  };
+
+#define KEYWORD_TABLES_SIZE(nodes, edges) \
+  ((3 + 0400 + 6 * (nodes) + 1 + 2 * (edges)) * sizeof (int))
+
+Lisp_Object Qkeyword_matcher_p;
+
+/* Set up KT to point into the tables of MATCHER.
+   Garbage collection can move them, so do this again after it.  */
+
+static
+keyword_tables (matcher, kt)
+     Lisp_Object matcher;
+     register struct keyword_tables *kt;
+{
+  register int *p = (int *) XSTRING (XKEYWORD_MATCHER (matcher)->tables)->data;
+
+  kt->nodes = p[0];
+  kt->edges = p[1];
+  kt->maxlen = p[2];
+  kt->root = p + 3;
+  kt->fail = kt->root + 0400;
+  kt->out = kt->fail + kt->nodes;
+  kt->dict = kt->out + kt->nodes;
+  kt->depth = kt->dict + kt->nodes;
+  kt->first = kt->depth + kt->nodes;
+  kt->edge_char = kt->first + kt->nodes + 1;
+  kt->edge_to = kt->edge_char + kt->edges;
+}
+
+/* Return the node that node N goes to on character C.  */
+
+static int
+keyword_step (kt, n, c)
+     register struct keyword_tables *kt;
+     register int n;
+     register int c;
+{
+  register int lo, hi, mid;
+
+  while (n)
+    {
+      lo = kt->first[n];
+      hi = kt->first[n + 1];
+      while (lo < hi)
+	{
+	  mid = (lo + hi) / 2;
+	  if (kt->edge_char[mid] < c)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+      if (lo < kt->first[n + 1] && kt->edge_char[lo] == c)
+	return kt->edge_to[lo];
+      n = kt->fail[n];
+    }
+  return kt->root[c];
+}
+
+DEFUN ("make-keyword-matcher", Fmake_keyword_matcher, Smake_keyword_matcher, 1, 2, 0,
+  "Return a keyword matcher that finds the strings in WORDS, a list or vector.\n\
+A keyword matcher looks for all the strings at once, in one pass over\n\
+the text; see keyword-search-forward and keyword-matches.\n\
+If optional second arg FOLD is non-nil, case is ignored in matching.\n\
+If a string occurs more than once in WORDS, its first occurrence is used.")
+  (words, fold)
+     Lisp_Object words, fold;
+{
+  Lisp_Object val, tables;
+  register struct Lisp_Vector *v;
+  register struct Lisp_Keyword_Matcher *m;
+  struct keyword_tables kt;
+  int rootmap[0400];
+  register int i, j, u, w, c;
+  int nwords, total, maxlen, nodes, edges, nroot, head, prev, e;
+  unsigned char *p;
+  int *space, *tchar, *tchild, *tsib, *tout, *newid, *queue;
+
+  words = Fvconcat (1, &words);
+  v = XVECTOR (words);
+  nwords = v->size;
+  total = maxlen = 0;
+  for (i = 0; i < nwords; i++)
+    {
+      CHECK_STRING (v->contents[i], 0);
+      if (!XSTRING (v->contents[i])->size)
+	error ("Empty string in keyword list");
+      total += XSTRING (v->contents[i])->size;
+      if (XSTRING (v->contents[i])->size > maxlen)
+	maxlen = XSTRING (v->contents[i])->size;
+    }
+
+  /* Make the trie.  Children of node 0 are in rootmap; those of other
+     nodes are in a list through tsib, in order of character.  */
+  space = (int *) xmalloc (6 * (total + 1) * sizeof (int));
+  tchar = space;
+  tchild = tchar + total + 1;
+  tsib = tchild + total + 1;
+  tout = tsib + total + 1;
+  newid = tout + total + 1;
+  queue = newid + total + 1;
+  bzero (rootmap, sizeof rootmap);
+  tout[0] = -1;
+  nodes = 1;
+  for (i = 0; i < nwords; i++)
+    {
+      p = XSTRING (v->contents[i])->data;
+      u = 0;
+      for (j = XSTRING (v->contents[i])->size; j > 0; j--)
+	{
+	  c = NULL (fold) ? *p++ : downcase_table[*p++];
+	  if (!u)
+	    w = rootmap[c];
+	  else
+	    for (prev = 0, w = tchild[u]; w && tchar[w] < c; w = tsib[w])
+	      prev = w;
+	  if (!w || tchar[w] != c)
+	    {
+	      tchar[nodes] = c;
+	      tchild[nodes] = 0;
+	      tout[nodes] = -1;
+	      if (!u)
+		rootmap[c] = nodes;
+	      else
+		{
+		  tsib[nodes] = w;
+		  if (prev)
+		    tsib[prev] = nodes;
+		  else
+		    tchild[u] = nodes;
+		}
+	      w = nodes++;
+	    }
+	  u = w;
+	}
+      if (tout[u] < 0)
+	tout[u] = i;
+    }
+
+  /* Number the nodes breadth first.  */
+  queue[0] = 0;
+  newid[0] = 0;
+  head = 0;
+  for (c = 0; c < 0400; c++)
+    if (rootmap[c])
+      {
+	newid[rootmap[c]] = ++head;
+	queue[head] = rootmap[c];
+      }
+  nroot = head;
+  for (i = 1; i <= head; i++)
+    for (w = tchild[queue[i]]; w; w = tsib[w])
+      {
+	newid[w] = ++head;
+	queue[head] = w;
+      }
+  edges = nodes - 1 - nroot;
+
+  tables = make_uninit_string (KEYWORD_TABLES_SIZE (nodes, edges));
+  ((int *) XSTRING (tables)->data)[0] = nodes;
+  ((int *) XSTRING (tables)->data)[1] = edges;
+  ((int *) XSTRING (tables)->data)[2] = maxlen;
+
+  val = Fmake_vector (make_number ((sizeof (struct Lisp_Keyword_Matcher)
+				    - sizeof (int) - sizeof (struct Lisp_Vector *))
+				   / sizeof (Lisp_Object)),
+		      Qnil);
+  XSETTYPE (val, Lisp_Keyword_Matcher);
+  m = XKEYWORD_MATCHER (val);
+  m->words = words;
+  m->fold = NULL (fold) ? Qnil : Qt;
+  m->tables = tables;
+  keyword_tables (val, &kt);
+
+  /* Fill in the edges first, since finding the fail link of a node
+     looks at the edges of nodes after it.  */
+  kt.depth[0] = 0;
+  for (c = 0; c < 0400; c++)
+    {
+      kt.root[c] = newid[rootmap[c]];
+      if (kt.root[c])
+	kt.depth[kt.root[c]] = 1;
+    }
+  for (i = 0, e = 0; i < nodes; i++)
+    {
+      kt.first[i] = e;
+      kt.out[i] = tout[queue[i]];
+      if (i)
+	for (w = tchild[queue[i]]; w; w = tsib[w])
+	  {
+	    kt.edge_char[e] = tchar[w];
+	    kt.edge_to[e++] = newid[w];
+	    kt.depth[newid[w]] = kt.depth[i] + 1;
+	  }
+    }
+  kt.first[nodes] = e;
+  free (space);
+
+  kt.fail[0] = kt.dict[0] = 0;
+  for (i = 1; i <= nroot; i++)
+    kt.fail[i] = kt.dict[i] = 0;
+  for (i = 1; i < nodes; i++)
+    for (e = kt.first[i]; e < kt.first[i + 1]; e++)
+      {
+	w = kt.edge_to[e];
+	u = keyword_step (&kt, kt.fail[i], kt.edge_char[e]);
+	kt.fail[w] = u;
+	kt.dict[w] = kt.out[u] >= 0 ? u : kt.dict[u];
+      }
+  return val;
+}
+
+DEFUN ("keyword-matcher-p", Fkeyword_matcher_p, Skeyword_matcher_p, 1, 1, 0,
+  "T if OBJECT is a keyword matcher.")
+  (obj)
+     Lisp_Object obj;
+{
+  return XTYPE (obj) == Lisp_Keyword_Matcher ? Qt : Qnil;
+}
+
+DEFUN ("keyword-search-forward", Fkeyword_search_forward, Skeyword_search_forward, 1, 3, 0,
+  "Search forward from point for any of the strings of keyword matcher MATCHER.\n\
+Of the occurrences that start earliest, the longest is found.\n\
+Set point to its end, set the match data for it, and return the string.\n\
+An optional second argument bounds the search; it is a buffer position.\n\
+The match found must not extend after that position.\n\
+Optional third argument, if t, means if fail just return nil (no error).\n\
+  If not nil and not t, move to limit of search and return nil.")
+  (matcher, bound, noerror)
+     Lisp_Object matcher, bound, noerror;
+{
+  struct keyword_tables kt;
+  register unsigned char *p, *stop;
+  register int n, o, c;
+  register unsigned char *trt;
+  unsigned char *base;
+  int pos, lim, limit, start, best = -1, best_start, best_end;
+
+  CHECK_KEYWORD_MATCHER (matcher, 0);
+  if (NULL (bound))
+    lim = NumCharacters + 1;
+  else
+    {
+      CHECK_NUMBER_COERCE_MARKER (bound, 1);
+      lim = XINT (bound);
+      if (lim < point)
+	error ("Invalid search bound (wrong side of point)");
+      if (lim > NumCharacters + 1)
+	lim = NumCharacters + 1;
+    }
+
+  keyword_tables (matcher, &kt);
+  trt = NULL (XKEYWORD_MATCHER (matcher)->fold) ? 0 : downcase_table;
+  immediate_quit = 1;
+  QUIT;
+
+  /* Words are found in order of where they end.  Any word that
+     starts where the best one so far does, or before, has been found
+     once the text up to that place plus the longest word is seen.  */
+  n = 0;
+  pos = point;
+  while (pos < lim)
+    {
+      BUFFER_SEGMENT (pos, lim, base, limit);
+      for (p = base + pos, stop = base + limit; p != stop; )
+	{
+	  c = *p++;
+	  n = keyword_step (&kt, n, trt ? trt[c] : c);
+	  for (o = kt.out[n] >= 0 ? n : kt.dict[n]; o; o = kt.dict[o])
+	    {
+	      start = p - base - kt.depth[o];
+	      if (best < 0 || start <= best_start)
+		{
+		  best = kt.out[o];
+		  best_start = start;
+		  best_end = p - base;
+		}
+	    }
+	  if (best >= 0 && p - base - best_start >= kt.maxlen)
+	    break;
+	}
+      pos = p - base;
+      if (best >= 0 && pos - best_start >= kt.maxlen)
+	break;
+    }
+  immediate_quit = 0;
+
+  if (best < 0)
+    {
+      if (NULL (noerror))
+	return signal_failure (matcher);
+      if (!EQ (noerror, Qt))
+	SetPoint (lim);
+      return Qnil;
+    }
+  search_regs.start[0] = best_start - 1;
+  search_regs.end[0] = best_end - 1;
+  SetPoint (best_end);
+  return XVECTOR (XKEYWORD_MATCHER (matcher)->words)->contents[best];
+}
+
+DEFUN ("keyword-matches", Fkeyword_matches, Skeyword_matches, 1, 4, 0,
+  "Find all occurrences of the strings of keyword matcher MATCHER in the region.\n\
+Optional args START and END bound the text scanned;\n\
+they default to the accessible portion of the buffer.\n\
+Occurrences are found in order of where they end, longest first\n\
+among those that end at the same place, and may overlap.\n\
+If optional fourth arg FUNCTION is non-nil, it is called with three\n\
+arguments for each occurrence: the string, and its start and end positions;\n\
+FUNCTION should not change the buffer's text; if it selects another buffer,\n\
+this one is selected again when it returns.  Then the value is nil.\n\
+Otherwise the value is a list of elements (STRING START END),\n\
+one for each occurrence, in the order found.")
+  (matcher, start, end, function)
+     Lisp_Object matcher, start, end, function;
+{
+  struct keyword_tables kt;
+  register unsigned char *p, *stop;
+  register int n, o, c;
+  register unsigned char *trt;
+  unsigned char *base;
+  int pos, lim, limit, called;
+  Lisp_Object val, word, buffer;
+  struct gcpro gcpro1, gcpro2, gcpro3, gcpro4;
+
+  CHECK_KEYWORD_MATCHER (matcher, 0);
+  if (NULL (start))
+    XFASTINT (start) = FirstCharacter;
+  if (NULL (end))
+    XFASTINT (end) = NumCharacters + 1;
+  validate_region (&start, &end);
+
+  val = Qnil;
+  buffer = Fcurrent_buffer ();
+  GCPRO4 (matcher, function, val, buffer);
+  keyword_tables (matcher, &kt);
+  trt = NULL (XKEYWORD_MATCHER (matcher)->fold) ? 0 : downcase_table;
+  immediate_quit = 1;
+  QUIT;
+
+  n = 0;
+  pos = XINT (start);
+  lim = XINT (end);
+  while (pos < lim)
+    {
+      called = 0;
+      BUFFER_SEGMENT (pos, lim, base, limit);
+      for (p = base + pos, stop = base + limit; p != stop && !called; )
+	{
+	  c = *p++;
+	  n = keyword_step (&kt, n, trt ? trt[c] : c);
+	  for (o = kt.out[n] >= 0 ? n : kt.dict[n]; o; o = kt.dict[o])
+	    {
+	      word = XVECTOR (XKEYWORD_MATCHER (matcher)->words)->contents[kt.out[o]];
+	      immediate_quit = 0;
+	      if (NULL (function))
+		val = Fcons (Fcons (word,
+				    Fcons (make_number (p - base - kt.depth[o]),
+					   Fcons (make_number (p - base), Qnil))),
+			     val);
+	      else
+		{
+		  pos = p - base;
+		  call3 (function, word, make_number (pos - kt.depth[o]),
+			 make_number (pos));
+		  /* FUNCTION may have selected another buffer; the scan
+		     must go on in this one.  */
+		  if (XBUFFER (buffer) != bf_cur)
+		    {
+		      if (NULL (XBUFFER (buffer)->name))
+			error ("Buffer was killed during keyword-matches");
+		      SetBfp (XBUFFER (buffer));
+		    }
+		  /* The tables and the buffer text may have moved.  */
+		  keyword_tables (matcher, &kt);
+		  called = 1;
+		}
+	      immediate_quit = 1;
+	    }
+	}
+      if (called)
+	{
+	  if (lim > NumCharacters + 1)
+	    lim = NumCharacters + 1;
+	}
+      else
+	pos = p - base;
+    }
+  immediate_quit = 0;
+  UNGCPRO;
+  return Fnreverse (val);
+}
+
+/* How replace-match changes the case of the replacement text
+   to follow the case of the text it replaces.  */
+
+enum replace_case { nochange, all_caps, cap_initial };
+
+/* Decide how to casify a replacement for the text from FROM to TO.  */
+
+static enum replace_case
+replace_case_action (from, to)
+     int from, to;
+{
+  enum replace_case case_action;
+  register int pos;
+  int some_multiletter_word = 0;
+  int some_letter = 0;
+  register char c, prevc;
+
+  prevc = '\n';
+  case_action = all_caps;
+
+  /* some_multiletter_word is set nonzero if any original word
+     is more than one letter long. */
+
+  for (pos = from; pos < to; pos++)
+    {
+      c = CharAt (pos);
+      if (c >= 'a' && c <= 'z')
+	{
+	  /* Cannot be all caps if any original char is lower case */
+
+	  case_action = cap_initial;
+	  if (SYNTAX (prevc) != Sword)
+	    {
+	      /* Cannot even be cap initials
+		 if some original initial is lower case */
+	      case_action = nochange;
+	      break;
+	    }
+	  else
+	    some_multiletter_word = 1;
+	}
+      else if (c >= 'A' && c <= 'Z')
+	{
+	  some_letter = 1;
+	  if (!some_multiletter_word && SYNTAX (prevc) == Sword)
+	    some_multiletter_word = 1;
+	}
+
+      prevc = c;
+    }
+
+  /* Do not make new text all caps
+     if the original text contained only single letter words. */
+  if (case_action == all_caps && !some_multiletter_word)
+    case_action = cap_initial;
+
+  if (!some_letter) case_action = nochange;
+  return case_action;
+}
+
 DEFUN ("replace-match", Freplace_match, Sreplace_match, 1, 3, 0,
   "Replace text matched by last search with NEWTEXT.\n\
 If second arg FIXEDCASE is non-nil, do not alter case of replacement text.\n\
@@ -735,11 +1447,9 @@ Leaves point at end of replacement text.")
   (string, fixedcase, literal)
      Lisp_Object string, fixedcase, literal;
 {
-  enum { nochange, all_caps, cap_initial } case_action = nochange;
+  enum replace_case case_action = nochange;
   register int pos, last;
-  int some_multiletter_word = 0;
-  int some_letter = 0;
-  register char c, prevc;
+  register char c;
   int inslen;
 
   if (search_regs.start[0] + 1 < FirstCharacter
@@ -748,53 +1458,10 @@ Leaves point at end of replacement text.")
     args_out_of_range(make_number (search_regs.start[0]),
 		      make_number (search_regs.end[0]));
 
+  /* Decide how to casify by examining the matched text. */
   if (NULL (fixedcase))
-    {
-      /* Decide how to casify by examining the matched text. */
-
-      last = search_regs.end[0];
-      prevc = '\n';
-      case_action = all_caps;
-
-      /* some_multiletter_word is set nonzero if any original word
-	 is more than one letter long. */
-      some_multiletter_word = 0;
-
-      for (pos = search_regs.start[0] + 1; pos <= last; pos++)
-	{
-	  c = CharAt (pos);
-	  if (c >= 'a' && c <= 'z')
-	    {
-	      /* Cannot be all caps if any original char is lower case */
-
-	      case_action = cap_initial;
-	      if (SYNTAX (prevc) != Sword)
-		{
-		  /* Cannot even be cap initials
-		     if some original initial is lower case */
-		  case_action = nochange;
-		  break;
-		}
-	      else
-		some_multiletter_word = 1;
-	    }
-	  else if (c >= 'A' && c <= 'Z')
-	    {
-	      some_letter = 1;
-	      if (!some_multiletter_word && SYNTAX (prevc) == Sword)
-		some_multiletter_word = 1;
-	    }
-
-	  prevc = c;
-	}
-
-      /* Do not make new text all caps
-	 if the original text contained only single letter words. */
-      if (case_action == all_caps && !some_multiletter_word)
-	case_action = cap_initial;
-
-      if (!some_letter) case_action = nochange;
-    }
+    case_action = replace_case_action (search_regs.start[0] + 1,
+				       search_regs.end[0] + 1);
 
   SetPoint (search_regs.end[0] + 1);
   if (!NULL (literal))
@@ -854,6 +1521,269 @@ place (l1, l2)
   GapTo (point);
   InsCStr (&CharAt (l1), l2 - l1);
 }
+
+/* replace-regexp-in-region builds the text that replaces the part of
+   the region from the first match to the end of the last one in
+   replace_text, and notes in replace_matches, for each match, where
+   it was and where its replacement goes.  Both are kept from one call
+   to the next, so that quitting out of a search loses nothing.  */
+
+static unsigned char *replace_text;
+static int replace_text_len, replace_text_size;
+static int *replace_matches;		/* Four ints for each match */
+static int replace_matches_size;
+
+/* Add LEN characters at P to replace_text.  */
+
+static
+replace_append (p, len)
+     unsigned char *p;
+     int len;
+{
+  if (len <= 0)
+    return;
+  if (replace_text_len + len > replace_text_size)
+    {
+      replace_text_size = 2 * (replace_text_len + len) + 100;
+      if (replace_text)
+	replace_text = (unsigned char *) xrealloc (replace_text, replace_text_size);
+      else
+	replace_text = (unsigned char *) xmalloc (replace_text_size);
+    }
+  bcopy (p, replace_text + replace_text_len, len);
+  replace_text_len += len;
+}
+
+/* Return where position POS goes when the NMATCHES matches in
+   replace_matches are replaced.  Text inside a match goes to the start
+   of its replacement, and text after a match follows its replacement,
+   as when each match is replaced with replace-match.  */
+
+static int
+replace_position (pos, nmatches)
+     int pos, nmatches;
+{
+  register int *m;
+  register int lo = 0, hi = nmatches, mid;
+
+  /* Find the last match that starts before POS.  */
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (replace_matches[4 * mid] < pos)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  if (!lo)
+    return pos;
+  m = replace_matches + 4 * (lo - 1);
+  if (pos < m[1])
+    return m[2];
+  return m[3] + pos - m[1];
+}
+
+DEFUN ("replace-regexp-in-region", Freplace_regexp_in_region, Sreplace_regexp_in_region, 2, 6, 0,
+  "Replace every match for REGEXP in the region with NEWTEXT, and return\n\
+the number of matches replaced.\n\
+Optional args START and END bound the region; they default to point\n\
+and the end of the accessible portion of the buffer.\n\
+FIXEDCASE and LITERAL are as for replace-match, and matches are\n\
+found and replaced as replace-regexp would, but the buffer is changed\n\
+only once, and undo treats all the replacements as a single change.\n\
+Leaves point at the end of the last replacement, if there is one.")
+  (regexp, newtext, start, end, fixedcase, literal)
+     Lisp_Object regexp, newtext, start, end, fixedcase, literal;
+{
+  struct re_pattern_buffer *bufp;
+  register int i, k;
+  unsigned char c, context;
+  Lisp_Object marker, markers;
+  int pos, from, to, lastrepl, copied, first, nmatches, nmarkers;
+  int contextlen, repl;
+  enum replace_case case_action;
+  int *m;
+  struct gcpro gcpro1;
+
+  CHECK_STRING (regexp, 0);
+  CHECK_STRING (newtext, 1);
+  if (NULL (start))
+    XFASTINT (start) = point;
+  if (NULL (end))
+    XFASTINT (end) = NumCharacters + 1;
+  validate_region (&start, &end);
+
+  /* Lock the file now, since that can run Lisp,
+     which must not change the text once the matches are found.  */
+  prepare_to_modify_buffer ();
+
+  bufp = compile_pattern (regexp,
+			  !NULL (bf_cur->case_fold_search) ? (char *) downcase_table : 0);
+
+  /* Nothing is changed until all the matches are found, so the text
+     from START on can be searched in one piece after the gap.  */
+  GapTo (XINT (start));
+
+  replace_text_len = 0;
+  nmatches = 0;
+  first = -1;
+  copied = lastrepl = 0;
+  pos = XINT (start);
+  while (pos < XINT (end))
+    {
+      /* The search must see the character before POS as it would be
+	 after the replacements so far, for the sake of \b, ^ and \`.  */
+      if (pos == lastrepl && replace_text_len)
+	{
+	  context = replace_text[replace_text_len - 1];
+	  contextlen = 1;
+	}
+      else
+	{
+	  k = pos == lastrepl ? first : pos;
+	  contextlen = k > FirstCharacter;
+	  if (contextlen)
+	    context = CharAt (k - 1);
+	}
+
+      /* Nothing has been changed yet, so C-g can stop the search
+	 right away, as in search_buffer.  */
+      immediate_quit = 1;
+      k = re_search_2 (bufp, (char *) &context, contextlen,
+		       (char *) &CharAt (pos), NumCharacters + 1 - pos,
+		       contextlen, XINT (end) - pos, &search_regs,
+		       contextlen + XINT (end) - pos);
+      immediate_quit = 0;
+      if (k == -2)
+	regexp_limit_exceeded (regexp);
+      if (k < 0)
+	break;
+      k = pos - contextlen - 1;
+      for (i = 0; i < RE_NREGS; i++)
+	{
+	  search_regs.start[i] += k;
+	  search_regs.end[i] += k;
+	}
+      from = search_regs.start[0] + 1;
+      to = search_regs.end[0] + 1;
+
+      /* Don't replace the null string
+	 right after end of previous replacement.  */
+      if (to == lastrepl)
+	{
+	  pos = lastrepl + 1;
+	  continue;
+	}
+
+      if (first < 0)
+	first = copied = from;
+      replace_append (&CharAt (copied), from - copied);
+      repl = replace_text_len;
+      if (!NULL (literal))
+	replace_append (XSTRING (newtext)->data, XSTRING (newtext)->size);
+      else
+	for (i = 0; i < XSTRING (newtext)->size; i++)
+	  {
+	    c = XSTRING (newtext)->data[i];
+	    if (c == '\\' && i + 1 < XSTRING (newtext)->size)
+	      {
+		c = XSTRING (newtext)->data[++i];
+		if (c == '&')
+		  k = 0;
+		else if (c >= '1' && c <= '9')
+		  k = c - '0';
+		else
+		  {
+		    replace_append (&c, 1);
+		    continue;
+		  }
+		if (search_regs.end[k] > search_regs.start[k])
+		  replace_append (&CharAt (search_regs.start[k] + 1),
+				  search_regs.end[k] - search_regs.start[k]);
+	      }
+	    else
+	      replace_append (&c, 1);
+	  }
+
+      if (!NULL (fixedcase))
+	case_action = nochange;
+      else
+	case_action = replace_case_action (from, to);
+      if (case_action == all_caps)
+	{
+	  for (i = repl; i < replace_text_len; i++)
+	    if (replace_text[i] >= 'a' && replace_text[i] <= 'z')
+	      replace_text[i] ^= 'a' - 'A';
+	}
+      else if (case_action == cap_initial)
+	{
+	  k = 0;
+	  for (i = repl; i < replace_text_len; i++)
+	    {
+	      c = replace_text[i];
+	      if (!k && c >= 'a' && c <= 'z')
+		replace_text[i] = c ^ ('a' - 'A');
+	      k = SYNTAX (c) == Sword;
+	    }
+	}
+
+      if (4 * (nmatches + 1) > replace_matches_size)
+	{
+	  replace_matches_size = 8 * (nmatches + 1);
+	  if (replace_matches)
+	    replace_matches = (int *) xrealloc (replace_matches,
+						replace_matches_size * sizeof (int));
+	  else
+	    replace_matches = (int *) xmalloc (replace_matches_size * sizeof (int));
+	}
+      m = replace_matches + 4 * nmatches++;
+      m[0] = from;
+      m[1] = to;
+      m[2] = first + repl;
+      m[3] = first + replace_text_len;
+
+      copied = lastrepl = pos = to;
+      QUIT;
+    }
+
+  if (!nmatches)
+    return make_number (0);
+
+  /* Work out where the markers go before the text changes under them.
+     Each marker is kept in a vector with its new position, since
+     del_range may run Lisp, and a garbage collection then would take
+     unused markers off the chain.  */
+  nmarkers = 0;
+  for (marker = bf_cur->markers; !NULL (marker); marker = XMARKER (marker)->chain)
+    nmarkers++;
+  markers = Fmake_vector (make_number (2 * nmarkers), Qnil);
+  i = 0;
+  for (marker = bf_cur->markers; !NULL (marker); marker = XMARKER (marker)->chain)
+    {
+      XVECTOR (markers)->contents[i++] = marker;
+      XVECTOR (markers)->contents[i++]
+	= make_number (replace_position (marker_position (marker), nmatches));
+    }
+  pos = replace_matches[4 * nmatches - 1];
+  GCPRO1 (markers);
+
+  /* Replace the text from the first match through the last at once,
+     so undo records one deletion and one insertion.  */
+  del_range (first, copied);
+  SetPoint (first);
+  InsCStr (replace_text, replace_text_len);
+
+  for (i = 0; i < 2 * nmarkers; i += 2)
+    {
+      marker = XVECTOR (markers)->contents[i];
+      if (XMARKER (marker)->buffer == bf_cur
+	  && marker_position (marker) != XINT (XVECTOR (markers)->contents[i + 1]))
+	Fset_marker (marker, XVECTOR (markers)->contents[i + 1], Qnil);
+    }
+  UNGCPRO;
+  SetPoint (pos);
+  return make_number (nmatches);
+}
 
 DEFUN ("match-beginning", Fmatch_beginning, Smatch_beginning, 1, 1, 0,
   "Return the character number of start of text matched by last regexp searched for.\n\
@@ -934,6 +1864,23 @@ LIST should have been created by calling match-data previously.")
   return Qnil;  
 }
 
+DEFUN ("regexp-statistics", Fregexp_statistics, Sregexp_statistics, 0, 0, 0,
+  "Return a list describing what the last regexp search cost.\n\
+The elements are the number of starting positions tried, the number of\n\
+steps taken, the number of times matching backtracked, and the most\n\
+failure points it kept at once.\n\
+A regexp that is matched as an automaton tries a run of starting positions\n\
+at once, counting it as one, and never backtracks.\n\
+See also regexp-step-limit.")
+  ()
+{
+  return Fcons (make_number (re_statistics.positions),
+		Fcons (make_number (re_statistics.steps),
+		       Fcons (make_number (re_statistics.backtracks),
+			      Fcons (make_number (re_statistics.max_failures),
+				     Qnil))));
+}
+
 /* Quote a string to inactivate reg-expr chars */
 
 DEFUN ("regexp-quote", Fregexp_quote, Sregexp_quote, 1, 1, 0,
@@ -957,7 +1904,7 @@ DEFUN ("regexp-quote", Fregexp_quote, Sregexp_quote, 1, 1, 0,
 	|| *cp == '^' || *cp == '$')
       size++;
 
-  ostr = Fmake_string (make_number (size), make_number (0));
+  ostr = make_uninit_string (size);
 
   /* Now copy the data into the new string, inserting escapes. */
 
@@ -981,14 +1928,14 @@ syms_of_search ()
   for (i = 0; i < 0400; i++)
     downcase_table[i] = (i >= 'A' && i <= 'Z') ? i + 040 : i;
 
-  searchbuf.allocated = 100;
-  searchbuf.buffer = (char *) malloc (searchbuf.allocated);
-  searchbuf.fastmap = search_fastmap;
-
   Qsearch_failed = intern ("search-failed");
   staticpro (&Qsearch_failed);
   Qinvalid_regexp = intern ("invalid-regexp");
   staticpro (&Qinvalid_regexp);
+  Qregexp_limit_exceeded = intern ("regexp-limit-exceeded");
+  staticpro (&Qregexp_limit_exceeded);
+  Qkeyword_matcher_p = intern ("keyword-matcher-p");
+  staticpro (&Qkeyword_matcher_p);
 
   Fput (Qsearch_failed, Qerror_conditions,
 	Fcons (Qsearch_failed, Fcons (Qerror, Qnil)));
@@ -1000,8 +1947,30 @@ syms_of_search ()
   Fput (Qinvalid_regexp, Qerror_message,
 	build_string ("Invalid regexp"));
 
-  last_regexp = Qnil;
-  staticpro (&last_regexp);
+  Fput (Qregexp_limit_exceeded, Qerror_conditions,
+	Fcons (Qregexp_limit_exceeded, Fcons (Qerror, Qnil)));
+  Fput (Qregexp_limit_exceeded, Qerror_message,
+	build_string ("Regexp search took more than regexp-step-limit steps"));
+
+  DefIntVar ("regexp-cache-size", &regexp_cache_size,
+    "*Maximum number of compiled regexps that searching keeps for reuse.");
+  regexp_cache_size = 20;
+
+  DefIntVar ("regexp-cache-hits", &regexp_cache_hits,
+    "Number of regexp searches that found their regexp already compiled.");
+  regexp_cache_hits = 0;
+
+  DefIntVar ("regexp-cache-misses", &regexp_cache_misses,
+    "Number of regexp searches that had to compile their regexp.");
+  regexp_cache_misses = 0;
+
+  DefIntVar ("regexp-step-limit", &re_step_limit,
+    "*If positive, the most steps a regexp search may take.\n\
+A search that would take more signals  regexp-limit-exceeded  instead,\n\
+whether or not it would have found a match.  Backtracking regexps\n\
+take a step for each part of the regexp tried, and others one for each\n\
+character looked at; regexp-statistics tells what a search took.");
+  re_step_limit = 0;
 
   defsubr (&Sstring_match);
   defsubr (&Slooking_at);
@@ -1014,10 +1983,16 @@ syms_of_search ()
   defsubr (&Sword_search_backward);
   defsubr (&Sre_search_forward);
   defsubr (&Sre_search_backward);
+  defsubr (&Smake_keyword_matcher);
+  defsubr (&Skeyword_matcher_p);
+  defsubr (&Skeyword_search_forward);
+  defsubr (&Skeyword_matches);
   defsubr (&Sreplace_match);
+  defsubr (&Sreplace_regexp_in_region);
   defsubr (&Smatch_beginning);
   defsubr (&Smatch_end);
   defsubr (&Smatch_data);
   defsubr (&Sstore_match_data);
   defsubr (&Sregexp_quote);
+  defsubr (&Sregexp_statistics);
 }
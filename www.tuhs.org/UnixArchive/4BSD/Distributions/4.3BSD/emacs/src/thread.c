@@ -0,0 +1,704 @@
+/* Cooperative Lisp threads for GNU Emacs.
+   Copyright (C) 1985 Richard M. Stallman.
+
+This file is part of GNU Emacs.
+
+GNU Emacs is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY.  No author or distributor
+accepts responsibility to anyone for the consequences of using it
+or for whether it serves any particular purpose or works at all,
+unless he says so in writing.  Refer to the GNU Emacs General Public
+License for full details.
+
+Everyone is granted permission to copy, modify and redistribute
+GNU Emacs, but only under the conditions described in the
+GNU Emacs General Public License.   A copy of this license is
+supposed to have been given to you along with GNU Emacs so you
+can know your rights and responsibilities.  It should be in a
+file named COPYING.  Among other things, the copyright notice
+and this notice must be preserved on all copies.  */
+
+
+/* A background thread calls a Lisp function with its own specpdl,
+ catches, condition handlers, backtrace, gcpro list, save-excursion
+ records and match data, and on its own C stack.
+
+ There is only one real C stack.  Every thread runs on it, starting
+ from wherever it was first switched to, and a thread that is not
+ running keeps a copy of its part of the stack, from the point where
+ it switched away down to the frame of main.  Switching to a thread
+ copies its part back and longjmps into it.  Dynamic bindings are
+ shallow, so the bindings of a thread that is switched away from are
+ taken out, innermost first, and put back when it is switched to.
+
+ The main thread is the one that runs the command loop.  Only it
+ schedules the others: it gives each a turn while it waits for
+ input, in sit-for and in accept-process-output.  A background
+ thread runs until it calls thread-yield, sit-for or
+ accept-process-output, or until it has evaluated for a while, and
+ then switches back to the main thread.  It looks for input every
+ THREAD_CHECK calls to eval and funcall and jumps in byte code, and
+ switches back at once if there is some, so typing preempts it.
+
+ Background threads run with inhibit-quit bound, so C-g is left to
+ the main thread.  A thread cannot read the keyboard.
+
+ A thread is a vector [FUNCTION NAME ERROR].  ERROR records the
+ (SIGNAL . DATA) of the error, if any, that ended it.  */
+
+#include "config.h"
+#include "lisp.h"
+#include "buffer.h"
+#include "commands.h"
+
+#include <setjmp.h>
+#include "regex.h"
+#include "thread.h"
+
+/* Calls to eval and funcall and byte-code jumps that a background
+   thread makes between looks for input.  */
+#define THREAD_CHECK 500
+
+/* Looks for input that a background thread makes before it switches
+   back to the main thread anyway.  */
+#define THREAD_SLICE 20
+
+/* Initial specpdl size of a background thread.  */
+#define THREAD_SPECPDL_SIZE 50
+
+extern struct catchtag *catchlist;
+extern struct backtrace *backtrace_list;
+extern int lisp_eval_depth;
+extern struct re_registers search_regs;
+
+static struct thread main_thread;
+
+struct thread *all_threads;
+struct thread *current_thread;
+
+/* The live background threads, as Lisp objects.  */
+static Lisp_Object Vthread_list;
+
+Lisp_Object Qthreadp;
+static Lisp_Object Qinhibit_quit;
+
+/* Calls and jumps left before the running thread looks for input,
+   or zero in the main thread; see Feval.  */
+int thread_countdown;
+
+/* Looks for input left in the running thread's turn.  */
+static int thread_checks;
+
+/* Address in the frame of main.  All threads' stacks lie beyond it.  */
+static char *thread_stack_base;
+
+/* Nonzero if the stack grows toward lower addresses.  */
+static int thread_stack_down;
+
+/* The thread that thread_restore_stack is to switch to.  */
+static struct thread *thread_target;
+
+/* Where thread_restore_stack has got to.  Storing its frame's
+   address here keeps its recursion from being made into a loop.  */
+char *thread_probe;
+
+/* Nonzero if some thread is waiting in accept-process-output.  */
+static int threads_waiting_for_output;
+
+static void thread_switch ();
+
+/* Called early in main, with the address of a variable in its frame.
+   This frame is deeper than that one, which tells which way the
+   stack grows.  */
+
+init_thread (stack_base)
+     char *stack_base;
+{
+  char here;
+
+  thread_stack_base = stack_base;
+  thread_stack_down = &here < stack_base;
+  main_thread.started = 1;
+  main_thread.next = 0;
+  all_threads = current_thread = &main_thread;
+  thread_countdown = 0;
+}
+
+char *
+thread_stack_addr (t, p)
+     register struct thread *t;
+     register char *p;
+{
+  if (t && p >= t->stack_low && p < t->stack_low + t->stack_size)
+    return t->stack + (p - t->stack_low);
+  return p;
+}
+
+/* Return nonzero if the running thread is not the main thread.  */
+
+int
+in_background_thread ()
+{
+  return current_thread != &main_thread;
+}
+
+/* Saving and restoring C stacks.  */
+
+/* Make sure T has room to save its stack from here,
+   before anything about the switch has been done.  */
+
+static void
+thread_reserve_stack (t)
+     register struct thread *t;
+{
+  char here;
+  register int size;
+
+  size = (thread_stack_down ? thread_stack_base - &here
+	  : &here - thread_stack_base) + 1024;
+  if (size > t->stack_space)
+    {
+      size += size / 2;
+      t->stack = t->stack ? (char *) xrealloc (t->stack, size)
+	: (char *) xmalloc (size);
+      t->stack_space = size;
+    }
+}
+
+static void
+thread_save_stack (t)
+     register struct thread *t;
+{
+  char here;
+
+  if (thread_stack_down)
+    {
+      t->stack_low = &here;
+      t->stack_size = thread_stack_base - &here;
+    }
+  else
+    {
+      t->stack_low = thread_stack_base;
+      t->stack_size = &here - thread_stack_base;
+    }
+  if (t->stack_size > t->stack_space)
+    abort ();
+  bcopy (t->stack_low, t->stack, t->stack_size);
+}
+
+/* Go deep enough that this frame is clear of the part of the stack
+   that thread_target saved, then copy that part back and jump to
+   where thread_target left off.  Does not return.  */
+
+static void
+thread_restore_stack ()
+{
+  char pad[1024];
+  register struct thread *t = thread_target;
+
+  thread_probe = pad;
+  if (thread_stack_down
+      ? pad + 2 * sizeof pad > t->stack_low
+      : pad < t->stack_low + t->stack_size + sizeof pad)
+    thread_restore_stack ();
+  bcopy (t->stack, t->stack_low, t->stack_size);
+  _longjmp (t->jmp, 1);
+}
+
+/* Saving and restoring the rest of a thread's state.  */
+
+static Lisp_Object
+thread_value (sym)
+     Lisp_Object sym;
+{
+  return NULL (Fboundp (sym)) ? Qunbound : Fsymbol_value (sym);
+}
+
+/* Exchange the values of the variables bound in BIND
+   with the values saved there.  */
+
+static void
+thread_swap_binding (bind)
+     register struct specbinding *bind;
+{
+  Lisp_Object tem;
+
+  if (XTYPE (bind->symbol) == Lisp_Symbol && !NULL (bind->symbol))
+    {
+      tem = thread_value (bind->symbol);
+      Fset (bind->symbol, bind->old_value);
+      bind->old_value = tem;
+    }
+}
+
+static void
+thread_save_state (t)
+     register struct thread *t;
+{
+  register struct specbinding *bind;
+
+  /* Take out the thread's bindings while its buffer is current,
+     so that buffer-local ones are taken out of the right buffer.  */
+  for (bind = specpdl_ptr; bind != specpdl;)
+    thread_swap_binding (--bind);
+  XSET (t->buffer, Lisp_Buffer, bf_cur);
+
+  t->specpdl = specpdl;
+  t->specpdl_ptr = specpdl_ptr;
+  t->specpdl_size = specpdl_size;
+  t->catchlist = catchlist;
+  t->handlerlist = handlerlist;
+  t->backtrace_list = backtrace_list;
+  t->gcprolist = gcprolist;
+  t->lisp_eval_depth = lisp_eval_depth;
+  t->immediate_quit = immediate_quit;
+  t->saved_positions = saved_positions;
+  t->saved_positions_depth = saved_positions_depth;
+  t->search_regs = search_regs;
+
+  /* The profiler looks at the backtrace from a signal handler;
+     don't let it see one whose frames are being overwritten.  */
+  backtrace_list = 0;
+}
+
+/* Make T's buffer current.  If it has been killed, use another.  */
+
+static void
+thread_set_buffer (t)
+     register struct thread *t;
+{
+  if (NULL (XBUFFER (t->buffer)->name))
+    t->buffer = Fother_buffer (t->buffer);
+  SetBfp (XBUFFER (t->buffer));
+}
+
+static void
+thread_restore_state (t)
+     register struct thread *t;
+{
+  register struct specbinding *bind;
+
+  specpdl = t->specpdl;
+  specpdl_ptr = t->specpdl_ptr;
+  specpdl_size = t->specpdl_size;
+  catchlist = t->catchlist;
+  handlerlist = t->handlerlist;
+  gcprolist = t->gcprolist;
+  lisp_eval_depth = t->lisp_eval_depth;
+  immediate_quit = t->immediate_quit;
+  saved_positions = t->saved_positions;
+  saved_positions_depth = t->saved_positions_depth;
+  search_regs = t->search_regs;
+
+  thread_set_buffer (t);
+  for (bind = specpdl; bind != specpdl_ptr; bind++)
+    thread_swap_binding (bind);
+
+  backtrace_list = t->backtrace_list;
+}
+
+/* Start the running thread's turn.  */
+
+static void
+thread_begin_turn ()
+{
+  register struct thread *t = current_thread;
+
+  if (t == &main_thread)
+    thread_countdown = 0;
+  else
+    {
+      thread_countdown = THREAD_CHECK;
+      thread_checks = THREAD_SLICE;
+    }
+  t->wake_time = 0;
+  if (t->waiting_for_output)
+    {
+      t->waiting_for_output = 0;
+      threads_waiting_for_output--;
+    }
+}
+
+/* Running a thread.  */
+
+static Lisp_Object
+thread_call (thread)
+     Lisp_Object thread;
+{
+  return Ffuncall (1, &XVECTOR (thread)->contents[0]);
+}
+
+/* The thread's own object is the tag that kill-thread throws to.  */
+
+static Lisp_Object
+thread_body ()
+{
+  return internal_catch (current_thread->object, thread_call,
+			 current_thread->object);
+}
+
+static Lisp_Object
+thread_error (data)
+     Lisp_Object data;
+{
+  XVECTOR (current_thread->object)->contents[2] = data;
+  return Qnil;
+}
+
+/* Run T, which has just been switched to for the first time,
+   with fresh dynamic state on the stack from here down.
+   When its function is done, switch to the main thread for good.  */
+
+static void
+thread_start (t)
+     register struct thread *t;
+{
+  t->started = 1;
+
+  specpdl = t->specpdl;
+  specpdl_ptr = specpdl;
+  specpdl_size = t->specpdl_size;
+  catchlist = 0;
+  handlerlist = 0;
+  backtrace_list = 0;
+  gcprolist = 0;
+  lisp_eval_depth = 0;
+  immediate_quit = 0;
+  saved_positions = t->saved_positions;
+  saved_positions_depth = 0;
+  thread_set_buffer (t);
+  thread_begin_turn ();
+
+  specbind (Qinhibit_quit, Qt);
+  internal_condition_case (thread_body, Qt, thread_error);
+  unbind_to (0);
+
+  /* It may have grown its specpdl.  */
+  t->specpdl = specpdl;
+  t->dead = 1;
+  Vthread_list = Fdelq (t->object, Vthread_list);
+  thread_switch (&main_thread);
+  abort ();
+}
+
+/* Suspend the running thread and run TO instead.
+   A dead thread is just left behind.  */
+
+static void
+thread_switch (to)
+     register struct thread *to;
+{
+  register struct thread *from = current_thread;
+
+  if (to == from)
+    return;
+  if (!from->dead)
+    {
+      thread_reserve_stack (from);
+      thread_save_state (from);
+      if (_setjmp (from->jmp))
+	{
+	  /* Back in FROM, on its own stack again.  */
+	  thread_restore_state (current_thread);
+	  thread_begin_turn ();
+	  if (current_thread->killed)
+	    {
+	      current_thread->killed = 0;
+	      Fthrow (current_thread->object, Qnil);
+	    }
+	  return;
+	}
+      thread_save_stack (from);
+    }
+
+  current_thread = to;
+  if (!to->started)
+    thread_start (to);
+  thread_target = to;
+  thread_restore_stack ();
+}
+
+/* Free the threads that have died.  Only the main thread does this,
+   since one of them may be the thread that is switching away.  */
+
+static void
+thread_reap ()
+{
+  register struct thread *t, **prev;
+
+  prev = &main_thread.next;
+  while (t = *prev)
+    {
+      if (t->dead)
+	{
+	  *prev = t->next;
+	  if (t->stack)
+	    free (t->stack);
+	  free (t->specpdl);
+	  free (t->saved_positions);
+	  free (t);
+	}
+      else
+	prev = &t->next;
+    }
+}
+
+/* Scheduling.  */
+
+/* Called by the main thread while it waits.  Give each background
+   thread that can run a turn, stopping early if input arrives.
+   Return how long to wait afterward, in the terms of
+   wait_reading_process_input: -1 (don't wait) if some thread can go
+   on at once, the seconds until the first sleeping thread wakes,
+   or 0 if there are no threads.  */
+
+int
+run_threads ()
+{
+  register struct thread *t;
+  long now;
+  int limit = 0;
+
+  if (current_thread != &main_thread || !main_thread.next)
+    return 0;
+
+  time (&now);
+  /* Threads made during the round get their turns in it too.  */
+  for (t = main_thread.next;
+       t && NULL (Vquit_flag) && !detect_input_pending ();
+       t = t->next)
+    if (!t->dead && t->wake_time <= now)
+      thread_switch (t);
+  thread_reap ();
+
+  time (&now);
+  for (t = main_thread.next; t; t = t->next)
+    {
+      if (t->wake_time <= now)
+	return -1;
+      if (!limit || t->wake_time - now < limit)
+	limit = t->wake_time - now;
+    }
+  return limit;
+}
+
+/* Called from Feval, Ffuncall and Fbyte_code in a background thread
+   every THREAD_CHECK times.  Switch to the main thread if there is
+   input for it or this thread's turn is over.  */
+
+void
+thread_preempt ()
+{
+  thread_countdown = THREAD_CHECK;
+  if (--thread_checks <= 0 || !NULL (Vquit_flag) || detect_input_pending ())
+    thread_switch (&main_thread);
+}
+
+/* Let other threads run.  */
+
+void
+thread_yield ()
+{
+  if (current_thread == &main_thread)
+    run_threads ();
+  else
+    thread_switch (&main_thread);
+}
+
+/* Called from sit-for in a background thread: let other threads run,
+   and don't come back to this one for SECONDS.  */
+
+void
+thread_sleep (seconds)
+     int seconds;
+{
+  if (seconds > 0)
+    {
+      time (&current_thread->wake_time);
+      current_thread->wake_time += seconds;
+    }
+  thread_switch (&main_thread);
+}
+
+/* Called from accept-process-output in a background thread: let the
+   main thread read the output, and come back when it has read some,
+   or after a second in case none is coming.  */
+
+void
+thread_wait_for_output ()
+{
+  current_thread->waiting_for_output = 1;
+  threads_waiting_for_output++;
+  thread_sleep (1);
+}
+
+/* Called by wait_reading_process_input when it has read output from
+   a process.  Make the threads waiting for output ready to run, and
+   return nonzero if there were any.  */
+
+int
+thread_output_arrived ()
+{
+  register struct thread *t;
+
+  if (!threads_waiting_for_output)
+    return 0;
+  for (t = main_thread.next; t; t = t->next)
+    if (t->waiting_for_output)
+      t->wake_time = 0;
+  return 1;
+}
+
+/* Lisp interface.  */
+
+static Lisp_Object
+check_thread (thread)
+     Lisp_Object thread;
+{
+  while (XTYPE (thread) != Lisp_Vector || XVECTOR (thread)->size != 3)
+    thread = wrong_type_argument (Qthreadp, thread);
+  return thread;
+}
+
+/* Return the thread whose Lisp object is THREAD, or 0 if it is dead.  */
+
+static struct thread *
+live_thread (thread)
+     Lisp_Object thread;
+{
+  register struct thread *t;
+
+  for (t = all_threads; t; t = t->next)
+    if (EQ (t->object, thread))
+      return t->dead ? 0 : t;
+  return 0;
+}
+
+DEFUN ("make-thread", Fmake_thread, Smake_thread, 1, 2, 0,
+  "Start a background thread that calls FUNCTION, with no arguments.\n\
+It has its own dynamic bindings, catches and condition handlers,\n\
+starts out in the current buffer, and runs with  inhibit-quit  bound to t.\n\
+It runs while Emacs waits for input, in sit-for and in accept-process-output,\n\
+and gives way when input arrives; it lets other threads run when it calls\n\
+thread-yield, sit-for or accept-process-output.\n\
+It cannot read from the keyboard.\n\
+Optional second arg NAME is a name for the thread.  Returns the thread.")
+  (function, name)
+     Lisp_Object function, name;
+{
+  register Lisp_Object thread;
+  register struct thread *t, **tail;
+
+  thread = Fmake_vector (make_number (3), Qnil);
+  XVECTOR (thread)->contents[0] = function;
+  XVECTOR (thread)->contents[1] = name;
+
+  t = (struct thread *) xmalloc (sizeof (struct thread));
+  bzero (t, sizeof (struct thread));
+  t->specpdl_size = THREAD_SPECPDL_SIZE;
+  t->specpdl = (struct specbinding *)
+    xmalloc (t->specpdl_size * sizeof (struct specbinding));
+  t->saved_positions = (struct saved_position *)
+    xmalloc (SAVED_POSITION_MAX * sizeof (struct saved_position));
+  bzero (t->saved_positions,
+	 SAVED_POSITION_MAX * sizeof (struct saved_position));
+  t->object = thread;
+  XSET (t->buffer, Lisp_Buffer, bf_cur);
+
+  /* Add it at the end, so threads take turns in the order they were made.  */
+  for (tail = &main_thread.next; *tail; tail = &(*tail)->next)
+    ;
+  *tail = t;
+  Vthread_list = nconc2 (Vthread_list, Fcons (thread, Qnil));
+  return thread;
+}
+
+DEFUN ("thread-yield", Fthread_yield, Sthread_yield, 0, 0, 0,
+  "Let the other threads run for a while.\n\
+In the main thread, give each background thread a turn unless input is pending.")
+  ()
+{
+  thread_yield ();
+  return Qnil;
+}
+
+DEFUN ("current-thread", Fcurrent_thread, Scurrent_thread, 0, 0, 0,
+  "Return the thread that is running.")
+  ()
+{
+  return current_thread->object;
+}
+
+DEFUN ("thread-alive-p", Fthread_alive_p, Sthread_alive_p, 1, 1, 0,
+  "T if THREAD has not finished or been killed.")
+  (thread)
+     Lisp_Object thread;
+{
+  thread = check_thread (thread);
+  return live_thread (thread) ? Qt : Qnil;
+}
+
+DEFUN ("kill-thread", Fkill_thread, Skill_thread, 1, 1, 0,
+  "Make THREAD throw out of its function, running its unwind-protect forms.\n\
+If THREAD is not the running thread, this switches to it to let it do so.")
+  (thread)
+     Lisp_Object thread;
+{
+  register struct thread *t;
+
+  thread = check_thread (thread);
+  t = live_thread (thread);
+  if (!t)
+    return Qnil;
+  if (t == &main_thread)
+    error ("The main thread cannot be killed");
+  if (t == current_thread)
+    Fthrow (thread, Qnil);
+  if (!t->started)
+    {
+      t->dead = 1;
+      Vthread_list = Fdelq (thread, Vthread_list);
+      return Qnil;
+    }
+  t->killed = 1;
+  thread_switch (t);
+  return Qnil;
+}
+
+DEFUN ("all-threads", Fall_threads, Sall_threads, 0, 0, 0,
+  "Return a list of the threads that are alive, the main thread first.")
+  ()
+{
+  return Fcons (main_thread.object, Fcopy_sequence (Vthread_list));
+}
+
+DEFUN ("thread-last-error", Fthread_last_error, Sthread_last_error, 1, 1, 0,
+  "Return (SIGNAL . DATA) for the error that ended THREAD, or nil.")
+  (thread)
+     Lisp_Object thread;
+{
+  thread = check_thread (thread);
+  return XVECTOR (thread)->contents[2];
+}
+
+syms_of_thread ()
+{
+  Qthreadp = intern ("threadp");
+  staticpro (&Qthreadp);
+  Qinhibit_quit = intern ("inhibit-quit");
+  staticpro (&Qinhibit_quit);
+
+  main_thread.object = Fmake_vector (make_number (3), Qnil);
+  XVECTOR (main_thread.object)->contents[1] = build_string ("main");
+  staticpro (&main_thread.object);
+  Vthread_list = Qnil;
+  staticpro (&Vthread_list);
+
+  defsubr (&Smake_thread);
+  defsubr (&Sthread_yield);
+  defsubr (&Scurrent_thread);
+  defsubr (&Sthread_alive_p);
+  defsubr (&Skill_thread);
+  defsubr (&Sall_threads);
+  defsubr (&Sthread_last_error);
+}
@@ -0,0 +1,67 @@
+/* Header file for cooperative Lisp threads.
+   Copyright (C) 1985 Richard M. Stallman.
+
+This file is part of GNU Emacs.
+
+GNU Emacs is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY.  No author or distributor
+accepts responsibility to anyone for the consequences of using it
+or for whether it serves any particular purpose or works at all,
+unless he says so in writing.  Refer to the GNU Emacs General Public
+License for full details.
+
+Everyone is granted permission to copy, modify and redistribute
+GNU Emacs, but only under the conditions described in the
+GNU Emacs General Public License.   A copy of this license is
+supposed to have been given to you along with GNU Emacs so you
+can know your rights and responsibilities.  It should be in a
+file named COPYING.  Among other things, the copyright notice
+and this notice must be preserved on all copies.  */
+
+
+/* Include <setjmp.h> and "regex.h" before this file.  */
+
+/* Everything a thread has of its own.  While a thread runs, its
+   state is in the usual global variables and its stack is the real
+   C stack; these fields hold it only while the thread is suspended.  */
+
+struct thread
+  {
+    Lisp_Object object;		/* The thread as a Lisp object */
+    Lisp_Object buffer;		/* Its current buffer */
+    struct thread *next;	/* Next in all_threads */
+    char started;		/* Nonzero once it has run at all */
+    char dead;			/* Nonzero once its function has returned */
+    char killed;		/* Nonzero if kill-thread was called on it */
+    char waiting_for_output;	/* Nonzero if in accept-process-output */
+    long wake_time;		/* Don't run it before this time */
+
+    /* Its C stack: STACK_SIZE bytes that were at STACK_LOW
+       are saved at STACK, which has room for STACK_SPACE bytes.  */
+    jmp_buf jmp;
+    char *stack, *stack_low;
+    int stack_size, stack_space;
+
+    /* Its dynamic state; see eval.c, alloc.c and editfns.c.  */
+    struct specbinding *specpdl, *specpdl_ptr;
+    int specpdl_size;
+    struct catchtag *catchlist;
+    struct handler *handlerlist;
+    struct backtrace *backtrace_list;
+    struct gcpro *gcprolist;
+    int lisp_eval_depth;
+    int immediate_quit;
+    struct saved_position *saved_positions;
+    int saved_positions_depth;
+    struct re_registers search_regs;
+  };
+
+/* All the threads that have not been reaped, the main thread first.  */
+extern struct thread *all_threads;
+
+/* The thread that is running.  */
+extern struct thread *current_thread;
+
+/* Translate P, an address on the stack of suspended thread T,
+   to where it is saved.  */
+extern char *thread_stack_addr ();